@@ -0,0 +1,36 @@
+#!/bin/sh
+#
+# alias_bench.sh
+#
+# Measures the shell's per-command dispatch cost as the number of aliases
+# grows. For each alias count a .aliases file is generated in a scratch HOME
+# and a batch script of builtin commands is run, half of them through an alias
+# and half not matching any alias.
+#
+# Usage:
+#	alias_bench.sh <shell binary> [commands]
+#
+# Output is one line per alias count:
+#	<aliases> <commands> <seconds> <ns per command>
+#
+
+shell=${1:?usage: alias_bench.sh <shell binary> [commands]}
+commands=${2:-100000}
+scratch=$(mktemp -d)
+trap 'rm -rf "$scratch"' EXIT
+
+for aliases in 0 10 100 1000 10000 100000; do
+	awk -v n="$aliases" 'BEGIN { for(i = 0; i < n; i++) print "alias a" i " getpath" }' \
+		> "$scratch/.aliases"
+	awk -v n="$aliases" -v c="$commands" 'BEGIN {
+		for(i = 0; i < c; i++)
+			print (n > 0 && i % 2) ? "a" (i % n) : "getpath"
+	}' > "$scratch/script"
+
+	start=$(date +%s%N)
+	HOME=$scratch "$shell" "$scratch/script" > /dev/null
+	end=$(date +%s%N)
+
+	awk -v a="$aliases" -v c="$commands" -v ns="$((end - start))" \
+		'BEGIN { printf "%d %d %.3f %.0f\n", a, c, ns / 1e9, ns / c }'
+done
@@ -0,0 +1,76 @@
+#!/bin/sh
+#
+# builtin_table.sh
+#
+# Generates the builtin lookup table in builtins.c. It searches for the
+# factors that give every builtin in the builtins[] table its own slot under
+# builtin_slot(), then prints the factors' #defines for shell.h and the
+# builtin_table initializer for builtins.c. Run it whenever a builtin is added,
+# removed or renamed.
+#
+# Usage:
+#	builtin_table.sh [builtins.c] [table size]
+#
+# Exits non-zero if no factors below 64 give a perfect hash at that size.
+#
+
+source=${1:-$(dirname "$0")/../src/builtins.c}
+size=${2:-128}
+
+awk -v size="$size" '
+BEGIN {
+	for(i = 1; i < 128; i++)
+		code[sprintf("%c", i)] = i
+}
+
+/^const builtin_t builtins\[\]/ { table = 1; next }
+table && /^};/ { table = 0 }
+table && match($0, /\{ "[^"]+"/) {
+	names[count++] = substr($0, RSTART + 3, RLENGTH - 4)
+}
+
+function slot(name, length_factor, first_factor,    chars, first, second, last) {
+	chars = length(name)
+	second = (chars > 1) ? code[substr(name, 2, 1)] : 0
+	first = code[substr(name, 1, 1)]
+	last = code[substr(name, chars, 1)]
+	return (chars * length_factor + first * first_factor + second + last) % size
+}
+
+END {
+	for(length_factor = 1; length_factor < 64; length_factor++) {
+		for(first_factor = 1; first_factor < 64; first_factor++) {
+			split("", used)
+			perfect = 1
+
+			for(i = 0; i < count && perfect; i++) {
+				s = slot(names[i], length_factor, first_factor)
+				perfect = !(s in used)
+				used[s] = i
+			}
+
+			if(perfect)
+				break
+		}
+
+		if(perfect)
+			break
+	}
+
+	if(!perfect) {
+		print "no perfect hash for " count " builtins in " size " slots" > "/dev/stderr"
+		exit 1
+	}
+
+	printf "#define BUILTIN_TABLE_SIZE\t%d\n", size
+	printf "#define BUILTIN_LENGTH_FACTOR\t%d\n", length_factor
+	printf "#define BUILTIN_FIRST_FACTOR\t%d\n\n", first_factor
+	printf "const builtin_t *const builtin_table[BUILTIN_TABLE_SIZE] = {\n"
+
+	for(s = 0; s < size; s++) {
+		if(s in used)
+			printf "\t[%d] = &builtins[%d],\t// %s\n", s, used[s], names[used[s]]
+	}
+
+	printf "};\n"
+}' "$source"
@@ -0,0 +1,61 @@
+#!/bin/sh
+#
+# history_soak.sh
+#
+# Pushes a large number of commands through an interactive shell and samples
+# its resident size as it goes, to check the history's memory stays flat once
+# the history is full. Commands are silent builtins of varying length, so the
+# history slabs are filled and reused unevenly.
+#
+# Usage:
+#	history_soak.sh <shell binary> [commands] [history size]
+#
+# Output is one line per tenth of the commands sent:
+#	<commands sent> <resident KiB>
+#
+# Exits non-zero if the resident size grows by more than 10% between the
+# samples taken after the history first fills and the last sample.
+#
+
+shell=${1:?usage: history_soak.sh <shell binary> [commands] [history size]}
+commands=${2:-1000000}
+size=${3:-10000}
+scratch=$(mktemp -d)
+trap 'rm -rf "$scratch"' EXIT
+
+mkfifo "$scratch/input"
+HOME=$scratch HISTSIZE=$size "$shell" -i < "$scratch/input" > /dev/null 2>&1 &
+pid=$!
+exec 3> "$scratch/input"
+
+step=$((commands / 10))
+sent=0
+baseline=0
+peak=0
+
+while [ "$sent" -lt "$commands" ]; do
+	awk -v s="$sent" -v n="$step" 'BEGIN {
+		for(i = s; i < s + n; i++)
+			printf "cd . # %d %.*s\n", i, i % 97, "................................................................................................."
+	}' >&3
+	sent=$((sent + step))
+
+	rss=$(awk '/^VmRSS/ { print $2 }' "/proc/$pid/status")
+	echo "$sent $rss"
+
+	# Start comparing once the history has had time to fill
+	if [ "$baseline" -eq 0 ] && [ "$sent" -ge $((size * 2)) ] && [ "$sent" -ge $((commands / 5)) ]; then
+		baseline=$rss
+	fi
+
+	[ "$rss" -gt "$peak" ] && peak=$rss
+done
+
+echo exit >&3
+exec 3>&-
+wait "$pid"
+
+if [ "$baseline" -gt 0 ] && [ "$peak" -gt $((baseline + baseline / 10)) ]; then
+	echo "history_soak: resident size grew from $baseline KiB to $peak KiB" >&2
+	exit 1
+fi
@@ -0,0 +1,298 @@
+/*
+ * micro_bench.c
+ *
+ * Measures the shell's internal operations in-process, linked against the
+ * shell's source files (everything but main.c), at data sizes from 10 to
+ * 100000:
+ *
+ *	tokenize	- tokenizing a line of <size> words
+ *	alias_get	- looking up an alias, with <size> aliases
+ *	alias_add	- adding and removing an alias, with <size> aliases
+ *	alias_expand	- expanding a command through an alias, with <size> aliases
+ *	history_add	- adding a command to a full history of <size> entries
+ *	history_get	- recalling a command by number (!N) from <size> entries
+ *	history_search	- recalling a command by prefix (!text) from <size> entries
+ *	history_list	- listing a history of <size> entries (to /dev/null)
+ *	builtin_find	- looking up a command name among the builtins (the same at
+ *			  every size)
+ *
+ * Allocations are counted by wrapping malloc(), calloc() and realloc() at link
+ * time, so only the shell's own allocations are counted.
+ *
+ * Compile (from the bench directory) with every shell source file but main.c:
+ *	gcc -I../src micro_bench.c ../src/[!m]*.c -pedantic -Wall -std=c99
+ *		-Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc -o micro_bench
+ *
+ * Usage:
+ *	micro_bench [benchmark]...
+ *
+ * Output is one line per benchmark and size:
+ *	<benchmark> <size> <ns per op> <allocations per op>
+ *
+ */
+
+#include "shell.h"
+
+#include <time.h>
+
+// Stores the data sizes to measure at
+static const int sizes[] = { 10, 100, 1000, 10000, 100000 };
+
+// Stores the number of allocations made through the wrappers
+static unsigned long allocations = 0;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *pointer, size_t size);
+
+void *__wrap_malloc(size_t size) {
+	allocations++;
+
+	return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+	allocations++;
+
+	return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *pointer, size_t size) {
+	allocations++;
+
+	return __real_realloc(pointer, size);
+}
+
+// Stores the state of the benchmark being run
+static int bench_size;
+static char *bench_line;
+static char *bench_buffer;
+static size_t bench_line_length;
+static token_list_t bench_tokens = { NULL, NULL, 0, 0 };
+
+/* Get the current time in nanoseconds */
+double bench_now() {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+void setup_tokenize() {
+	size_t size = bench_size * 16 + 1;
+
+	bench_line = malloc(size);
+	bench_buffer = malloc(size);
+	bench_line_length = 0;
+
+	for(int i = 0; i < bench_size; i++) {
+		// A mix of plain, quoted and escaped words
+		const char *format = (i % 4 == 3) ? "\"w %d\" " : (i % 4 == 2) ? "w\\ %d " : "word%d ";
+
+		bench_line_length += sprintf(bench_line + bench_line_length, format, i);
+	}
+
+	return;
+}
+
+void op_tokenize(int i) {
+	memcpy(bench_buffer, bench_line, bench_line_length + 1);
+	tokenize(bench_buffer, &bench_tokens);
+
+	return;
+}
+
+void setup_aliases() {
+	char key[32];
+
+	alias_loaded = true;
+
+	for(int i = 0; i < bench_size; i++) {
+		sprintf(key, "a%d", i);
+		alias_add(key, (i % 2) ? "getpath" : "cd /tmp");
+	}
+
+	return;
+}
+
+void op_alias_get(int i) {
+	char key[32];
+
+	sprintf(key, "a%d", (int)((i * 7919L) % bench_size));
+	alias_get(key);
+
+	return;
+}
+
+void op_alias_add(int i) {
+	alias_add("benchmark", "getpath");
+	alias_remove("benchmark");
+
+	return;
+}
+
+void op_alias_expand(int i) {
+	char key[32];
+	char *tokens[] = { key, "x", NULL };
+	char **expanded;
+	int *depths;
+
+	sprintf(key, "a%d", (int)((i * 7919L) % bench_size));
+	alias_expand(2, tokens, &expanded, &depths);
+	alias_release();
+
+	return;
+}
+
+void setup_history() {
+	char command[64];
+
+	history_capacity = bench_size;
+	history_ready();
+
+	for(int i = 0; i < bench_size; i++) {
+		sprintf(command, "cd /tmp/directory%d", i);
+		history_add(command);
+	}
+
+	return;
+}
+
+void op_history_add(int i) {
+	char command[64];
+
+	sprintf(command, "cd /tmp/directory%d", i);
+	history_add(command);
+
+	return;
+}
+
+void op_history_get(int i) {
+	history_previous(history_first + (int)((i * 7919L) % bench_size));
+
+	return;
+}
+
+void op_history_search(int i) {
+	char prefix[64];
+	int match;
+
+	sprintf(prefix, "cd /tmp/directory%d", (int)((i * 7919L) % bench_size));
+	history_search(prefix, true, &match, 1);
+
+	return;
+}
+
+void op_history_list(int i) {
+	command_history();
+
+	return;
+}
+
+void setup_builtins() {
+	return;
+}
+
+void op_builtin_find(int i) {
+	// Builtins, including ones that shared a slot before the table was 
+	// perfect, and names that aren't builtins
+	static const char *names[] = { "true", "time", "exit", "echo", "[", "cd",
+		"ls", "grep" };
+
+	builtin_find(names[i % 8]);
+
+	return;
+}
+
+// Defines a benchmark, setting up its data and then timing an operation
+typedef struct {
+	const char *name;
+	void (*setup)();
+	void (*op)(int i);
+} bench_t;
+
+static const bench_t benches[] = {
+	{ "tokenize", setup_tokenize, op_tokenize },
+	{ "alias_get", setup_aliases, op_alias_get },
+	{ "alias_add", setup_aliases, op_alias_add },
+	{ "alias_expand", setup_aliases, op_alias_expand },
+	{ "history_add", setup_history, op_history_add },
+	{ "history_get", setup_history, op_history_get },
+	{ "history_search", setup_history, op_history_search },
+	{ "history_list", setup_history, op_history_list },
+	{ "builtin_find", setup_builtins, op_builtin_find },
+	{ NULL, NULL, NULL }
+};
+
+/* Run a benchmark at one size and output the result
+
+   The benchmark runs in a child process, so each starts with the shell's
+   state untouched. Operations are repeated until at least 200ms have passed.
+ */
+void bench_run(const bench_t *bench, int size) {
+	pid_t pid;
+
+	fflush(stdout);
+
+	if((pid = fork()) == 0) {
+		FILE *output = fdopen(dup(STDOUT_FILENO), "w");
+		double start, elapsed;
+		unsigned long start_allocations;
+		long ops = 0;
+
+		bench_size = size;
+		bench->setup();
+
+		// Anything the operations print is thrown away
+		freopen("/dev/null", "w", stdout);
+
+		start_allocations = allocations;
+		start = bench_now();
+
+		do {
+			for(int i = 0; i < 16; i++, ops++)
+				bench->op((int)ops);
+
+			elapsed = bench_now() - start;
+		} while(elapsed < 2e8);
+
+		fprintf(output, "%s %d %.1f %.2f\n", bench->name, size, elapsed / ops,
+			(double)(allocations - start_allocations) / ops);
+		fclose(output);
+		_exit(0);
+	}
+
+	waitpid(pid, NULL, 0);
+
+	return;
+}
+
+int main(int argc, char *argv[]) {
+	char home[] = "/tmp/micro_bench.XXXXXX";
+
+	// The shell's files go in a scratch HOME, and aren't written by the
+	// history (no log is opened)
+	if(mkdtemp(home) == NULL) {
+		perror("mkdtemp");
+		return 1;
+	}
+
+	env_home = home;
+
+	for(int i = 0; benches[i].name != NULL; i++) {
+		bool selected = (argc == 1);
+
+		for(int j = 1; j < argc; j++) {
+			if(strcmp(argv[j], benches[i].name) == 0)
+				selected = true;
+		}
+
+		for(size_t j = 0; selected && j < sizeof(sizes) / sizeof(sizes[0]); j++)
+			bench_run(&benches[i], sizes[j]);
+	}
+
+	rmdir(home);
+
+	return 0;
+}
@@ -0,0 +1,60 @@
+#!/bin/sh
+#
+# script_bench.sh
+#
+# Measures how much of a script's run time is spent parsing it. A script of
+# builtin commands is generated and run with its parsed form cached, once
+# with the cache emptied before every run (cold) and once reusing the cache
+# (cached), and once more with caching off.
+#
+# Usage:
+#	script_bench.sh <shell binary> [lines] [runs]
+#
+# Output is one line per mode:
+#	<mode> <lines> <runs> <seconds per run> <ns per line>
+#
+
+shell=${1:?usage: script_bench.sh <shell binary> [lines] [runs]}
+lines=${2:-10000}
+runs=${3:-20}
+scratch=$(mktemp -d)
+trap 'rm -rf "$scratch"' EXIT
+
+awk -v n="$lines" 'BEGIN {
+	for(i = 0; i < n; i++) {
+		if(i % 5 == 0)
+			print "# line " i
+		else if(i % 5 == 1)
+			print "X" (i % 100) "=\"value " i "\"; test -n \"$X" (i % 100) "\" && true"
+		else if(i % 5 == 2)
+			print "echo \"line " i "\" '\''quoted $X'\'' word" i " > /dev/null"
+		else if(i % 5 == 3)
+			print "printf \"%s %d\\n\" \"" i "\" " i " >> /dev/null || false"
+		else
+			print "[ " i " -gt 0 ] ; false || true"
+	}
+}' > "$scratch/script"
+
+# The cache isn't written for a script changed within the last second
+touch -d '1 minute ago' "$scratch/script"
+
+measure() {
+	mode=$1
+	start=$(date +%s%N)
+
+	for run in $(seq "$runs"); do
+		[ "$mode" = cold ] && rm -rf "$scratch/cache"
+		SHELL_SCRIPT_CACHE=$cache HOME=$scratch "$shell" "$scratch/script" > /dev/null
+	done
+
+	end=$(date +%s%N)
+
+	awk -v m="$mode" -v l="$lines" -v r="$runs" -v ns="$((end - start))" \
+		'BEGIN { printf "%s %d %d %.4f %.0f\n", m, l, r, ns / r / 1e9, ns / r / l }'
+}
+
+cache=off
+measure off
+cache=$scratch/cache
+measure cold
+measure cached
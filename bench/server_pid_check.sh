@@ -0,0 +1,41 @@
+#!/bin/sh
+#
+# server_pid_check.sh
+#
+# Checks that each client of a shell server is run by its own worker, by
+# running two clients and comparing their $$, which must differ from each
+# other and from the server's pid.
+#
+# Usage:
+#	server_pid_check.sh <shell binary>
+#
+# Output is the three pids and whether they're distinct. Exits non-zero if
+# they aren't.
+#
+
+shell=${1:?usage: server_pid_check.sh <shell binary>}
+scratch=$(mktemp -d)
+socket=$scratch/server.sock
+
+HOME=$scratch "$shell" --server "$socket" 2> "$scratch/server.err" &
+server=$!
+trap 'kill "$server" 2> /dev/null; rm -rf "$scratch"' EXIT
+
+# Wait for the socket to appear
+for i in 1 2 3 4 5 6 7 8 9 10; do
+	[ -S "$socket" ] && break
+	sleep 0.1
+done
+
+first=$(HOME=$scratch "$shell" --client "$socket" -c 'echo $$')
+second=$(HOME=$scratch "$shell" --client "$socket" -c 'echo $$')
+
+echo "server $server, first client $first, second client $second"
+
+if [ -z "$first" ] || [ -z "$second" ] || [ "$first" = "$second" ] ||
+	[ "$first" = "$server" ] || [ "$second" = "$server" ]; then
+	echo "not distinct"
+	exit 1
+fi
+
+echo "distinct"
@@ -0,0 +1,414 @@
+/*
+ * shell_bench.c
+ *
+ * Drives the shell with generated workloads and measures its throughput,
+ * per-command latency and resident size. The shell is run interactively
+ * (-i --quiet) in a scratch HOME, and each command's latency is the time from
+ * writing its line to the shell showing the next prompt.
+ *
+ * Workloads:
+ *	builtin	- builtin commands only (cd .)
+ *	external	- an external command (true), found through PATH
+ *	alias	- commands run through 1000 saved aliases, some nested
+ *	history	- recalls (!<no>, !<text>, !?<text>?) from 10000 saved entries
+ *	long	- builtin lines of 1000 quoted, escaped and plain arguments
+ *
+ * Usage:
+ *	shell_bench [-n commands] [-l spawn|fork] [-t tag] <shell binary>
+ *		[workload]...
+ *
+ * Output is one JSON object per line for each workload, e.g.
+ *	{"tag": "", "workload": "builtin", "launcher": "spawn", "commands": 5000,
+ *	 "seconds": 0.41, "commands_per_sec": 12195.1, "latency_us": {"p50": 78.1,
+ *	 "p90": 96.0, "p99": 142.7, "max": 1020.5}, "rss_kib": [2480, ...]}
+ * (on a single line), where rss_kib holds the shell's resident size after
+ * each tenth of the commands.
+ *
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#define RSS_SAMPLES	10
+#define LONG_ARGUMENTS	1000
+
+// Defines a workload, which writes its saved files and forms its commands
+typedef struct {
+	const char *name;
+	void (*setup)(const char *home);
+	void (*command)(int i, char *line, size_t size);
+} workload_t;
+
+/* Get the current time in microseconds */
+double now_us() {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/* Open one of the shell's files in the scratch HOME for writing */
+FILE *home_open(const char *home, const char *name) {
+	char path[512];
+	FILE *file;
+
+	snprintf(path, sizeof(path), "%s/%s", home, name);
+
+	if((file = fopen(path, "w")) == NULL) {
+		perror(path);
+		exit(1);
+	}
+
+	return file;
+}
+
+/* Saved files shared by every workload, none */
+void setup_none(const char *home) {
+	fclose(home_open(home, ".aliases"));
+	fclose(home_open(home, ".hist_list"));
+
+	return;
+}
+
+/* Saved files for the alias workload, 1000 aliases, a tenth of them nested */
+void setup_alias(const char *home) {
+	FILE *file = home_open(home, ".aliases");
+
+	for(int i = 0; i < 1000; i++) {
+		if(i % 10 == 9)
+			fprintf(file, "alias a%d a%d\n", i, i - 1);
+		else
+			fprintf(file, "alias a%d cd .\n", i);
+	}
+
+	fclose(file);
+	fclose(home_open(home, ".hist_list"));
+
+	return;
+}
+
+/* Saved files for the history workload, 10000 history entries */
+void setup_history(const char *home) {
+	FILE *file = home_open(home, ".hist_list");
+
+	for(int i = 1; i <= 10000; i++)
+		fprintf(file, "%d cd . # entry %d\n", i, i);
+
+	fclose(file);
+	fclose(home_open(home, ".aliases"));
+
+	return;
+}
+
+void command_builtin(int i, char *line, size_t size) {
+	snprintf(line, size, "cd .\n");
+
+	return;
+}
+
+void command_external(int i, char *line, size_t size) {
+	snprintf(line, size, "true\n");
+
+	return;
+}
+
+void command_alias(int i, char *line, size_t size) {
+	snprintf(line, size, "a%d\n", (i * 7) % 1000);
+
+	return;
+}
+
+void command_history(int i, char *line, size_t size) {
+	int entry = 1 + (i * 7919) % 10000;
+
+	switch(i % 3) {
+		case 0:
+			snprintf(line, size, "!%d\n", entry);
+			break;
+		case 1:
+			snprintf(line, size, "!cd\n");
+			break;
+		default:
+			snprintf(line, size, "!?entry %d?\n", entry);
+			break;
+	}
+
+	return;
+}
+
+void command_long(int i, char *line, size_t size) {
+	size_t length = snprintf(line, size, "getpath");
+
+	for(int j = 0; j < LONG_ARGUMENTS && length + 32 < size; j++) {
+		switch(j % 3) {
+			case 0:
+				length += snprintf(line + length, size - length, " \"arg %d\"", j);
+				break;
+			case 1:
+				length += snprintf(line + length, size - length, " a\\ %d", i);
+				break;
+			default:
+				length += snprintf(line + length, size - length, " word%d", j);
+				break;
+		}
+	}
+
+	snprintf(line + length, size - length, "\n");
+
+	return;
+}
+
+// Stores the workloads, in the order they're run by default
+static const workload_t workloads[] = {
+	{ "builtin", setup_none, command_builtin },
+	{ "external", setup_none, command_external },
+	{ "alias", setup_alias, command_alias },
+	{ "history", setup_history, command_history },
+	{ "long", setup_none, command_long },
+	{ NULL, NULL, NULL }
+};
+
+/* Read the shell's output until it shows a prompt
+
+   Params:
+   	fd - The shell's standard output
+
+   Returns:
+   	0 once a prompt is seen, -1 if the shell stopped first
+ */
+int wait_prompt(int fd) {
+	static char last[2] = { 0, 0 };
+	char buffer[65536];
+
+	while(1) {
+		ssize_t result = read(fd, buffer, sizeof(buffer));
+
+		if(result <= 0)
+			return -1;
+
+		// Remember the last two characters, a prompt may arrive split up
+		if(result >= 2) {
+			last[0] = buffer[result - 2];
+			last[1] = buffer[result - 1];
+		}
+		else {
+			last[0] = last[1];
+			last[1] = buffer[0];
+		}
+
+		if(last[0] == '$' && last[1] == ' ') {
+			last[0] = last[1] = 0;
+			return 0;
+		}
+	}
+}
+
+/* Get the resident size of a process in KiB */
+long rss_kib(pid_t pid) {
+	char path[64], line[256];
+	long rss = -1;
+	FILE *file;
+
+	snprintf(path, sizeof(path), "/proc/%d/status", (int)pid);
+
+	if((file = fopen(path, "r")) == NULL)
+		return -1;
+
+	while(fgets(line, sizeof(line), file) != NULL) {
+		if(sscanf(line, "VmRSS: %ld", &rss) == 1)
+			break;
+	}
+
+	fclose(file);
+
+	return rss;
+}
+
+int compare_double(const void *a, const void *b) {
+	double x = *(const double *)a, y = *(const double *)b;
+
+	return (x > y) - (x < y);
+}
+
+/* Get a percentile of some sorted latencies */
+double percentile(const double *sorted, int count, double p) {
+	int index = (int)(p / 100.0 * (count - 1) + 0.5);
+
+	return sorted[index];
+}
+
+/* Run a workload and output its results
+
+   Params:
+   	workload - The workload to run
+   	shell - The shell binary
+   	home - The scratch HOME directory
+   	commands - The number of commands to time
+   	launcher - The launcher to set before timing, or NULL
+   	tag - A label for the results
+ */
+void run_workload(const workload_t *workload, const char *shell, const char *home,
+	int commands, const char *launcher, const char *tag) {
+	char *argv[] = { (char *)shell, "-i", "--quiet", NULL };
+	double *latencies = malloc(commands * sizeof(double));
+	long rss[RSS_SAMPLES];
+	int samples = 0;
+	size_t line_size = LONG_ARGUMENTS * 32;
+	char *line = malloc(line_size);
+	int in[2], out[2];
+	double start, total;
+	pid_t pid;
+
+	workload->setup(home);
+
+	if(pipe(in) == -1 || pipe(out) == -1) {
+		perror("pipe");
+		exit(1);
+	}
+
+	if((pid = fork()) == 0) {
+		dup2(in[0], STDIN_FILENO);
+		dup2(out[1], STDOUT_FILENO);
+		dup2(out[1], STDERR_FILENO);
+		close(in[0]);
+		close(in[1]);
+		close(out[0]);
+		close(out[1]);
+		execv(shell, argv);
+		_exit(127);
+	}
+
+	close(in[0]);
+	close(out[1]);
+
+	if(wait_prompt(out[0]) == -1) {
+		fprintf(stderr, "shell_bench: %s didn't start\n", shell);
+		exit(1);
+	}
+
+	if(launcher != NULL) {
+		snprintf(line, line_size, "launcher %s\n", launcher);
+		write(in[1], line, strlen(line));
+		wait_prompt(out[0]);
+	}
+
+	start = now_us();
+
+	for(int i = 0; i < commands; i++) {
+		double command_start;
+
+		workload->command(i, line, line_size);
+		command_start = now_us();
+
+		if(write(in[1], line, strlen(line)) == -1 || wait_prompt(out[0]) == -1) {
+			fprintf(stderr, "shell_bench: shell stopped during %s\n", workload->name);
+			exit(1);
+		}
+
+		latencies[i] = now_us() - command_start;
+
+		if(samples < RSS_SAMPLES && (i + 1) % (commands / RSS_SAMPLES) == 0)
+			rss[samples++] = rss_kib(pid);
+	}
+
+	total = now_us() - start;
+
+	kill(pid, SIGKILL);
+	waitpid(pid, NULL, 0);
+	close(in[1]);
+	close(out[0]);
+
+	qsort(latencies, commands, sizeof(double), compare_double);
+
+	printf("{\"tag\": \"%s\", \"workload\": \"%s\", \"launcher\": \"%s\", "
+		"\"commands\": %d, \"seconds\": %.3f, \"commands_per_sec\": %.1f, "
+		"\"latency_us\": {\"p50\": %.1f, \"p90\": %.1f, \"p99\": %.1f, \"max\": %.1f}, "
+		"\"rss_kib\": [", tag, workload->name,
+		(launcher != NULL) ? launcher : "default", commands, total / 1e6,
+		commands / (total / 1e6), percentile(latencies, commands, 50),
+		percentile(latencies, commands, 90), percentile(latencies, commands, 99),
+		latencies[commands - 1]);
+
+	for(int i = 0; i < samples; i++)
+		printf((i == 0) ? "%ld" : ", %ld", rss[i]);
+
+	printf("]}\n");
+	fflush(stdout);
+
+	free(latencies);
+	free(line);
+
+	return;
+}
+
+int main(int argc, char *argv[]) {
+	char home[] = "/tmp/shell_bench.XXXXXX";
+	const char *launcher = NULL;
+	const char *tag = "";
+	int commands = 5000;
+	int option;
+
+	while((option = getopt(argc, argv, "n:l:t:")) != -1) {
+		switch(option) {
+			case 'n':
+				commands = atoi(optarg);
+				break;
+			case 'l':
+				launcher = optarg;
+				break;
+			case 't':
+				tag = optarg;
+				break;
+			default:
+				commands = 0;
+				break;
+		}
+	}
+
+	if(optind >= argc || commands < RSS_SAMPLES) {
+		fprintf(stderr, "usage: shell_bench [-n commands] [-l spawn|fork] [-t tag] "
+			"<shell binary> [workload]...\n");
+		return 1;
+	}
+
+	if(mkdtemp(home) == NULL) {
+		perror("mkdtemp");
+		return 1;
+	}
+
+	setenv("HOME", home, 1);
+	signal(SIGPIPE, SIG_IGN);
+
+	for(int i = 0; workloads[i].name != NULL; i++) {
+		bool selected = (optind + 1 == argc);
+
+		for(int j = optind + 1; j < argc; j++) {
+			if(strcmp(argv[j], workloads[i].name) == 0)
+				selected = true;
+		}
+
+		if(selected)
+			run_workload(&workloads[i], argv[optind], home, commands, launcher, tag);
+	}
+
+	// Clean up the scratch HOME
+	char path[512];
+
+	snprintf(path, sizeof(path), "%s/.aliases", home);
+	unlink(path);
+	snprintf(path, sizeof(path), "%s/.hist_list", home);
+	unlink(path);
+	rmdir(home);
+
+	return 0;
+}
@@ -0,0 +1,137 @@
+/*
+ * spawn_bench.c
+ *
+ * Measures how long it takes to start and reap a trivial program with each of
+ * the shell's launchers (fork() + execv() and posix_spawn()) as the resident
+ * size of the launching process grows.
+ *
+ * Usage:
+ *	spawn_bench [iterations] [program]
+ *
+ * Output is one line per resident size and launcher:
+ *	<launcher> <resident MiB> <mean us> <min us> <max us>
+ *
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+extern char **environ;
+
+// Resident sizes to measure at, in MiB
+static const size_t sizes[] = { 0, 16, 64, 256, 1024 };
+
+/* Get the current time in microseconds */
+double now_us() {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/* Start the program with fork() and execv() */
+pid_t launch_fork(const char *path, char *argv[]) {
+	pid_t pid = fork();
+
+	if(pid == 0) {
+		execv(path, argv);
+		_exit(127);
+	}
+
+	return pid;
+}
+
+/* Start the program with posix_spawn() */
+pid_t launch_spawn(const char *path, char *argv[]) {
+	pid_t pid;
+
+	if(posix_spawn(&pid, path, NULL, NULL, argv, environ) != 0)
+		return -1;
+
+	return pid;
+}
+
+/* Time a number of launches and output the results
+
+   Params:
+   	name - The launcher name to output
+   	launch - The launcher to measure
+   	resident - The current resident size in MiB
+   	iterations - The number of launches to time
+   	path - The program to launch
+ */
+void measure(const char *name, pid_t (*launch)(const char *, char *[]),
+	size_t resident, int iterations, const char *path) {
+	char *argv[] = { (char *)path, NULL };
+	double total = 0, min = 0, max = 0;
+
+	for(int i = 0; i < iterations; i++) {
+		double start = now_us();
+		pid_t pid = launch(path, argv);
+
+		if(pid < 0) {
+			perror(name);
+			exit(1);
+		}
+
+		waitpid(pid, NULL, 0);
+
+		double elapsed = now_us() - start;
+
+		total += elapsed;
+
+		if(i == 0 || elapsed < min)
+			min = elapsed;
+
+		if(elapsed > max)
+			max = elapsed;
+	}
+
+	printf("%s %zu %.1f %.1f %.1f\n", name, resident, total / iterations, min, max);
+	fflush(stdout);
+
+	return;
+}
+
+int main(int argc, char *argv[]) {
+	int iterations = (argc > 1) ? atoi(argv[1]) : 200;
+	const char *path = (argc > 2) ? argv[2] : "/bin/true";
+	size_t resident = 0;
+
+	if(iterations <= 0) {
+		fprintf(stderr, "usage: spawn_bench [iterations] [program]\n");
+		return 1;
+	}
+
+	for(size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+		// Grow the resident set to the next size, touching every page so the
+		// memory is really mapped (and has to be copied on fork)
+		size_t grow = (sizes[i] - resident) << 20;
+
+		if(grow > 0) {
+			char *block = malloc(grow);
+
+			if(block == NULL) {
+				perror("malloc");
+				return 1;
+			}
+
+			memset(block, 1, grow);
+			resident = sizes[i];
+		}
+
+		measure("fork", launch_fork, resident, iterations, path);
+		measure("spawn", launch_spawn, resident, iterations, path);
+	}
+
+	return 0;
+}
@@ -0,0 +1,253 @@
+/*
+ * startup_bench.c
+ *
+ * Measures how long the shell takes to become ready, with .aliases and
+ * .hist_list files of growing size in a scratch HOME. Three things are timed
+ * from just before the shell is started:
+ *
+ *	prompt	- until an interactive shell (-i --quiet) shows its first prompt
+ *	command	- until an interactive shell has run its first command (pwd),
+ *		  which is when the aliases are loaded
+ *	batch	- until a batch shell (-c pwd) has run its command
+ *	client	- until a client (--client <socket> -c pwd) has had its command
+ *		  run by a server, started beforehand with the same files
+ *
+ * Usage:
+ *	startup_bench <shell binary> [iterations]
+ *
+ * Output is one line per file size and measurement:
+ *	<measurement> <entries> <mean us> <min us> <max us>
+ *
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+// Number of aliases and history entries to measure with
+static const int sizes[] = { 0, 1000, 10000, 100000 };
+
+/* Get the current time in microseconds */
+double now_us() {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/* Write the .aliases and .hist_list files
+
+   Params:
+   	home - The scratch HOME directory
+   	entries - The number of aliases and history entries to write
+ */
+void write_files(const char *home, int entries) {
+	char path[512];
+	FILE *file;
+
+	snprintf(path, sizeof(path), "%s/.aliases", home);
+
+	if((file = fopen(path, "w")) == NULL) {
+		perror(path);
+		exit(1);
+	}
+
+	for(int i = 0; i < entries; i++)
+		fprintf(file, "alias a%d getpath\n", i);
+
+	fclose(file);
+
+	snprintf(path, sizeof(path), "%s/.hist_list", home);
+
+	if((file = fopen(path, "w")) == NULL) {
+		perror(path);
+		exit(1);
+	}
+
+	for(int i = 1; i <= entries; i++)
+		fprintf(file, "%d cd /tmp/dir%d\n", i, i);
+
+	fclose(file);
+
+	return;
+}
+
+/* Start the shell and time how long until some text appears in its output
+
+   Params:
+   	shell - The shell binary
+   	argv - The arguments to start it with
+   	input - Text to write to its standard input, or NULL
+   	wait_for - The text to wait for
+
+   Returns:
+   	The time taken in microseconds
+ */
+double time_shell(const char *shell, char *argv[], const char *input,
+	const char *wait_for) {
+	int in[2], out[2];
+	char buffer[4096];
+	size_t length = 0;
+	double start;
+	pid_t pid;
+
+	if(pipe(in) == -1 || pipe(out) == -1) {
+		perror("pipe");
+		exit(1);
+	}
+
+	start = now_us();
+
+	if((pid = fork()) == 0) {
+		dup2(in[0], STDIN_FILENO);
+		dup2(out[1], STDOUT_FILENO);
+		close(in[0]);
+		close(in[1]);
+		close(out[0]);
+		close(out[1]);
+		execv(shell, argv);
+		_exit(127);
+	}
+
+	close(in[0]);
+	close(out[1]);
+
+	if(input != NULL)
+		write(in[1], input, strlen(input));
+
+	// Read until the text turns up, or the shell finishes
+	while(length < sizeof(buffer) - 1) {
+		ssize_t result = read(out[0], buffer + length, sizeof(buffer) - 1 - length);
+
+		if(result <= 0)
+			break;
+
+		length += result;
+		buffer[length] = '\0';
+
+		if(strstr(buffer, wait_for) != NULL)
+			break;
+	}
+
+	double elapsed = now_us() - start;
+
+	// The time to exit isn't part of startup
+	kill(pid, SIGKILL);
+	waitpid(pid, NULL, 0);
+	close(in[1]);
+	close(out[0]);
+
+	return elapsed;
+}
+
+/* Time a number of shell starts and output the results */
+void measure(const char *name, int entries, int iterations, const char *shell,
+	char *argv[], const char *input, const char *wait_for) {
+	double total = 0, min = 0, max = 0;
+
+	for(int i = 0; i < iterations; i++) {
+		double elapsed = time_shell(shell, argv, input, wait_for);
+
+		total += elapsed;
+
+		if(i == 0 || elapsed < min)
+			min = elapsed;
+
+		if(elapsed > max)
+			max = elapsed;
+	}
+
+	printf("%s %d %.1f %.1f %.1f\n", name, entries, total / iterations, min, max);
+	fflush(stdout);
+
+	return;
+}
+
+/* Start a shell server and wait for its socket to appear
+
+   Params:
+   	shell - The shell binary
+   	socket_path - Where the server is to create its socket
+
+   Returns:
+   	The server's process ID
+ */
+pid_t start_server(const char *shell, const char *socket_path) {
+	struct timespec pause = { 0, 1000000 };
+	struct stat info;
+	pid_t pid;
+
+	unlink(socket_path);
+
+	if((pid = fork()) == 0) {
+		execl(shell, shell, "--server", socket_path, (char *)NULL);
+		_exit(127);
+	}
+
+	while(stat(socket_path, &info) == -1)
+		nanosleep(&pause, NULL);
+
+	return pid;
+}
+
+int main(int argc, char *argv[]) {
+	char home[] = "/tmp/startup_bench.XXXXXX";
+	const char *shell = (argc > 1) ? argv[1] : NULL;
+	int iterations = (argc > 2) ? atoi(argv[2]) : 50;
+	char *interactive_argv[] = { (char *)shell, "-i", "--quiet", NULL };
+	char *batch_argv[] = { (char *)shell, "-c", "pwd", NULL };
+	char socket_path[600];
+	char *client_argv[] = { (char *)shell, "--client", socket_path, "-c", "pwd", NULL };
+
+	if(shell == NULL || iterations <= 0) {
+		fprintf(stderr, "usage: startup_bench <shell binary> [iterations]\n");
+		return 1;
+	}
+
+	if(mkdtemp(home) == NULL) {
+		perror("mkdtemp");
+		return 1;
+	}
+
+	setenv("HOME", home, 1);
+	snprintf(socket_path, sizeof(socket_path), "%s/server.sock", home);
+
+	// Every measurement's pwd then prints HOME
+	chdir(home);
+
+	for(size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+		write_files(home, sizes[i]);
+
+		measure("prompt", sizes[i], iterations, shell, interactive_argv, NULL, "$ ");
+		measure("command", sizes[i], iterations, shell, interactive_argv, "pwd\n",
+			home);
+		measure("batch", sizes[i], iterations, shell, batch_argv, NULL, home);
+
+		pid_t server = start_server(shell, socket_path);
+
+		measure("client", sizes[i], iterations, shell, client_argv, NULL, home);
+		kill(server, SIGTERM);
+		waitpid(server, NULL, 0);
+	}
+
+	// Clean up the scratch HOME
+	char path[512];
+
+	snprintf(path, sizeof(path), "%s/.aliases", home);
+	unlink(path);
+	snprintf(path, sizeof(path), "%s/.hist_list", home);
+	unlink(path);
+	unlink(socket_path);
+	rmdir(home);
+
+	return 0;
+}
@@ -0,0 +1,124 @@
+#!/bin/sh
+#
+# utilities_check.sh
+#
+# Checks the echo, printf, test and [ builtins against the coreutils programs
+# of the same names. Each case is run by the shell and, with the utility
+# replaced by its program, by sh, and the output, errors and status of the
+# two are compared.
+#
+# Usage:
+#	utilities_check.sh <shell binary> [coreutils directory]
+#
+# Output is a line for each case that differs, with both results, and then:
+#	<cases> cases, <differences> differ
+#
+# Exits non-zero if any case differs.
+#
+
+shell=${1:?usage: utilities_check.sh <shell binary> [coreutils directory]}
+bin=${2:-/usr/bin}
+scratch=$(mktemp -d)
+trap 'rm -rf "$scratch"' EXIT
+
+cat > "$scratch/cases" <<'CASES'
+echo -n a b
+echo -e 'a\tb\n'
+echo -E 'a\tb'
+echo -neX a
+echo -e 'x\c y'
+echo -e '\0101\x41'
+printf '%s-%d\n' a 1 b 2 c
+printf '%5.2f|%-4s|%x|%o|%e\n' 3.14159 ab 255 8 12345.678
+printf '%d\n' abc
+printf '%d\n' 12abc
+printf '%b\n' 'a\tb\0101'
+printf "%c%c\n" hello world
+printf '%d\n' "'A"
+printf '%*d|\n' 5 3
+printf '%i %u\n' -3 -1
+printf '%s\n'
+printf 'abc\n' extra
+printf 'abc\n' extra more
+printf 'abc\c' extra
+printf '%.3s\n' abcdef
+printf '%#x %+d % d\n' 255 5 5
+printf '%ld %lld %hd %hhd %jd %zd %td\n' 1 2 3 300 5 6 7
+printf '%lu %lx %Lf %lf\n' 1 255 1.5 2.5
+printf '%s %s %s\n' a b
+printf '\x41\101\n'
+printf '%d\n' 0x1f
+printf '%d\n' 010
+printf '%g\n' 0.0001
+printf '%5s|%-5d|\n' a 3
+test 1 -eq 1
+test abc
+test ''
+test
+test !
+test -n
+test -z ''
+test a = a -a b = c
+test \( a = a \) -o b = c
+test 1 -lt x
+test 99999999999999999999 -gt 1
+test -99999999999999999999 -lt 99999999999999999998
+test 99999999999999999999 -eq 099999999999999999999
+test 99999999999999999999 -lt 99999999999999999998
+test -0 -eq 0
+test +5 -gt 4
+test -5 -lt -10
+test -10 -lt -5
+test 00 -ne -0
+test 5 -gt ' '
+test - -eq 0
+test '' -eq 0
+[ 1 -eq 1 ]
+[ 1 -eq 1
+test -d /
+test -f /
+test -e /nonexistent
+test ' 5' -eq 5
+test 5 -eq ' 5 '
+test a '<' b
+test b '>' a
+test ! a = b
+test \( a \)
+test 1 -eq
+test -l abc -eq 3
+test -l abc -gt -l ab
+test 3 -eq -l abc
+test 3 -eq -l
+test 3 = -l abc
+test -l abc = abc
+test -l abc -nt /
+test -l abc
+test ! -l abc -eq 3
+test a -a -l
+test a -a -z
+test a -a -q
+test -q -a a
+test 1 -foo
+test x y
+test -q y
+CASES
+
+cases=0
+differences=0
+
+while IFS= read -r line; do
+	cases=$((cases + 1))
+
+	(cd "$scratch" && HOME=$scratch "$shell" -c "$line" > out 2>&1; echo "status $?" >> out)
+	mine=$(cat "$scratch/out")
+	(cd "$scratch" && sh -c "$bin/$line" > out 2>&1; echo "status $?" >> out)
+	theirs=$(sed "s#^$bin/##" "$scratch/out")
+
+	if [ "$mine" != "$theirs" ]; then
+		differences=$((differences + 1))
+		printf '%s\n  shell:     %s\n  coreutils: %s\n' "$line" "$mine" "$theirs"
+	fi
+done < "$scratch/cases"
+
+echo "$cases cases, $differences differ"
+[ "$differences" -eq 0 ]
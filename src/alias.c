@@ -0,0 +1,759 @@
+/*
+ * alias.c
+ *
+ * CS210 Semester 2 Shell Project
+ *
+ * Aliases: the alias table, its arena and alias expansion.
+ *
+ * Authors:
+ *	Mark Anderson <mark.anderson@strath.ac.uk>
+ *	Andrew Logan <andrew.logan@strath.ac.uk>
+ *	John Meikle <john.meikle@strath.ac.uk>
+ *
+ * Version:
+ *	0.9-stage9
+ *
+ */
+
+#include "shell.h"
+
+// Stores the aliases in an open addressing hash table
+alias_t *alias_table = NULL;
+unsigned int alias_slots = 0;
+unsigned int alias_used = 0;	// slots not empty, including deleted ones
+
+// Stores the alias names and values, one after another
+char *alias_arena = NULL;
+size_t alias_arena_length = 0;
+size_t alias_arena_size = 0;
+size_t alias_arena_waste = 0;	// bytes no longer used by any alias
+char *alias_retired = NULL;	// old arena blocks, see alias_retire()
+
+// Changed whenever the aliases change, to invalidate cached expansions
+unsigned int alias_generation = 1;
+
+// Stores the number of aliases present
+unsigned int alias_count = 0;
+
+// Stores how deeply aliases were nested in the last line expanded, 0 if it 
+// used none
+int alias_depth = 0;
+
+// Stores how deeply aliases were nested to give each token of the last line 
+// expanded, 0 for the line's own tokens
+int *alias_token_depths = NULL;
+int alias_token_depths_size = 0;
+
+// Stores whether the saved aliases have been loaded, and whether they've been
+// changed since
+bool alias_loaded = false;
+bool alias_changed = false;
+
+/* Find the slot an alias is, or would be, stored in
+   
+   Params:
+   	key - The alias name (e.g. dir)
+   	hash - The hash of the alias name
+   	
+   Returns:
+   	The alias's slot if it exists. Otherwise the slot it should be added to,
+   	which is the first deleted slot passed over, if any, or an empty slot.
+ */
+alias_t *alias_slot(const char *key, unsigned int hash) {
+	unsigned int mask = alias_slots - 1;
+	alias_t *deleted = NULL;
+	
+	// Linear probing, the table is never allowed to fill up
+	for(unsigned int i = hash & mask; ; i = (i + 1) & mask) {
+		alias_t *slot = &alias_table[i];
+		
+		if(slot->state == ALIAS_EMPTY)
+			return (deleted != NULL) ? deleted : slot;
+		
+		if(slot->state == ALIAS_DELETED) {
+			if(deleted == NULL)
+				deleted = slot;
+		}
+		else if(slot->hash == hash && strcmp(alias_arena + slot->key, key) == 0)
+			return slot;
+	}
+}
+
+/* Copy bytes to the end of the alias arena
+   
+   When the arena has to grow it is moved to a new block, and the old block is
+   only released by alias_release(), so strings taken from the arena remain 
+   valid for the rest of the line even if a command changes the aliases.
+   
+   Params:
+   	data - The bytes to copy
+   	length - The number of bytes
+   	
+   Returns:
+   	The offset of the copy within the arena.
+ */
+size_t alias_arena_append(const void *data, size_t length) {
+	size_t offset = alias_arena_length;
+	
+	if(alias_arena_length + length > alias_arena_size) {
+		// Arena is full, so move it to a bigger block
+		char *old_arena = alias_arena;
+		
+		while(alias_arena_length + length > alias_arena_size)
+			alias_arena_size = (alias_arena_size == 0) ? 4096 : alias_arena_size * 2;
+		
+		alias_arena = malloc(alias_arena_size);
+		
+		if(old_arena != NULL) {
+			memcpy(alias_arena, old_arena, alias_arena_length);
+			alias_retire(old_arena);
+		}
+	}
+	
+	memcpy(alias_arena + offset, data, length);
+	alias_arena_length += length;
+	
+	return offset;
+}
+
+/* Copy a string to the end of the alias arena
+   
+   Params:
+   	string - The string to copy
+   	
+   Returns:
+   	The offset of the copy within the arena.
+ */
+size_t alias_arena_add(const char *string) {
+	return alias_arena_append(string, strlen(string) + 1);
+}
+
+/* Put an old arena block aside until the current line has finished
+   
+   Params:
+   	block - The block, which must be at least the size of a pointer
+ */
+void alias_retire(char *block) {
+	memcpy(block, &alias_retired, sizeof(char *));
+	alias_retired = block;
+	
+	return;
+}
+
+/* Release the arena blocks put aside by alias_retire(), called between lines */
+void alias_release() {
+	while(alias_retired != NULL) {
+		char *block = alias_retired;
+		
+		memcpy(&alias_retired, block, sizeof(char *));
+		free(block);
+	}
+	
+	return;
+}
+
+/* Find the length of an alias's pre-split value within the arena
+   
+   The value is stored as one entry per token, each a byte holding 0 for a 
+   word followed by the terminated word, or the operator's index + 1.
+   
+   Params:
+   	tokens - The start of the tokens
+   	count - The number of tokens
+   	
+   Returns:
+   	The number of bytes the tokens take up.
+ */
+size_t alias_tokens_length(const char *tokens, int count) {
+	const char *position = tokens;
+	
+	for(int i = 0; i < count; i++) {
+		if(*position++ == 0)
+			position += strlen(position) + 1;
+	}
+	
+	return position - tokens;
+}
+
+/* Store the pre-split form of an alias's value in the arena
+   
+   Params:
+   	alias - The alias to store it for
+   	value - The alias's value
+   	
+   Returns:
+   	If the value couldn't be split (e.g. an unterminated quote), false is 
+   	returned. Otherwise true.
+ */
+bool alias_split(alias_t *alias, const char *value) {
+	char *buffer = malloc(strlen(value) + 1);
+	token_list_t tokens = { NULL, NULL, 0, 0 };
+	int count;
+	
+	strcpy(buffer, value);
+	
+	if((count = tokenize(buffer, &tokens)) < 0) {
+		token_list_free(&tokens);
+		free(buffer);
+		return false;
+	}
+	
+	alias->tokens = alias_arena_length;
+	alias->token_count = count;
+	
+	for(int i = 0; i < count; i++) {
+		char type = 0;
+		
+		for(int j = 0; operators[j] != NULL; j++) {
+			if(tokens.words[i] == operators[j])
+				type = j + 1;
+		}
+		
+		alias_arena_append(&type, 1);
+		
+		if(type == 0)
+			alias_arena_add(tokens.words[i]);
+	}
+	
+	token_list_free(&tokens);
+	free(buffer);
+	
+	return true;
+}
+
+/* Count an alias's space in the arena as waste, and drop its expansion
+   
+   Params:
+   	alias - The alias being removed or replaced
+   	key - Whether the alias's name is also no longer needed
+ */
+void alias_discard(alias_t *alias, bool key) {
+	if(key)
+		alias_arena_waste += strlen(alias_arena + alias->key) + 1;
+	
+	alias_arena_waste += strlen(alias_arena + alias->value) + 1;
+	alias_arena_waste += alias_tokens_length(alias_arena + alias->tokens, 
+		alias->token_count);
+	
+	free(alias->expansion);
+	alias->expansion = NULL;
+	
+	return;
+}
+
+/* Compare two aliases by the order they were added in, for qsort() */
+int alias_compare(const void *a, const void *b) {
+	const alias_t *alias_a = *(alias_t * const *)a;
+	const alias_t *alias_b = *(alias_t * const *)b;
+	
+	return (alias_a->key > alias_b->key) - (alias_a->key < alias_b->key);
+}
+
+/* List the aliases in the order they were added
+   
+   Returns:
+   	A newly allocated array of alias_count aliases.
+ */
+alias_t **alias_list() {
+	alias_t **list = malloc((alias_count + 1) * sizeof(alias_t *));
+	unsigned int count = 0;
+	
+	for(unsigned int i = 0; i < alias_slots; i++) {
+		if(alias_table[i].state == ALIAS_USED)
+			list[count++] = &alias_table[i];
+	}
+	
+	// Keys are added to the end of the arena, so their offsets give the order
+	qsort(list, count, sizeof(alias_t *), alias_compare);
+	
+	return list;
+}
+
+/* Rewrite the alias arena without the space left by removed and replaced 
+   aliases, keeping the aliases in the same order */
+void alias_arena_compact() {
+	alias_t **list = alias_list();
+	char *old_arena = alias_arena;
+	
+	alias_arena = NULL;
+	alias_arena_length = 0;
+	alias_arena_size = 0;
+	alias_arena_waste = 0;
+	
+	for(unsigned int i = 0; i < alias_count; i++) {
+		const char *tokens = old_arena + list[i]->tokens;
+		
+		list[i]->key = alias_arena_add(old_arena + list[i]->key);
+		list[i]->value = alias_arena_add(old_arena + list[i]->value);
+		list[i]->tokens = alias_arena_append(tokens, 
+			alias_tokens_length(tokens, list[i]->token_count));
+	}
+	
+	alias_retire(old_arena);
+	free(list);
+	
+	return;
+}
+
+/* Resize the alias table, which also clears out deleted slots
+   
+   Params:
+   	slots - The new number of slots, which must be a power of two
+ */
+void alias_table_resize(unsigned int slots) {
+	alias_t *old_table = alias_table;
+	unsigned int old_slots = alias_slots;
+	
+	alias_table = calloc(slots, sizeof(alias_t));
+	alias_slots = slots;
+	alias_used = alias_count;
+	
+	for(unsigned int i = 0; i < old_slots; i++) {
+		if(old_table[i].state == ALIAS_USED)
+			*alias_slot(alias_arena + old_table[i].key, old_table[i].hash) = old_table[i];
+	}
+	
+	free(old_table);
+	
+	return;
+}
+
+/* Find an alias in the alias table
+   
+   Params:
+   	key - The alias name (e.g. dir)
+   	
+   Returns:
+   	The alias, or NULL if there's no such alias.
+ */
+alias_t *alias_find(const char *key) {
+	alias_t *slot;
+	
+	// Check if key value is NULL, if so we can't continue, so return NULL
+	if(key == NULL || alias_count == 0)
+		return NULL;
+	
+	slot = alias_slot(key, hash_string(key));
+	
+	return (slot->state == ALIAS_USED) ? slot : NULL;
+}
+
+/* Search the alias list for the value key
+   
+   Params:
+   	key - The alias name (e.g. dir)
+   	
+   Returns:
+   	The corresponding value (i.e. what the alias resolves to), which is only
+   	valid until the aliases are next changed. If the key isn't found, NULL is 
+   	returned.
+ */
+char *alias_get(const char *key) {
+	alias_t *alias = alias_find(key);
+	
+	return (alias == NULL) ? NULL : alias_arena + alias->value;
+}
+
+/* Add an alias to the alias list
+   
+   Params:
+   	key - The alias name (e.g. dir)
+   	value - What the alias resolves to (e.g. ls -a)
+   	
+   Returns:
+   	If the addition failed, false is returned. Otherwise true is returned.
+ */
+bool alias_add(const char *key, const char *value) {
+	alias_t alias;
+	alias_t *slot;
+	
+	// Check if either values are NULL, if so we can't continue
+	if(key == NULL || value == NULL)
+		return false;
+	
+	memset(&alias, 0, sizeof(alias));
+	alias.state = ALIAS_USED;
+	alias.expansion = NULL;
+	
+	// Split the value up front, so using the alias needs no tokenizing
+	if(!alias_split(&alias, value))
+		return false;
+	
+	if((alias_used + 1) * 4 > alias_slots * 3)
+		// Keep the table at most three quarters full (including deleted slots)
+		alias_table_resize((alias_count + 1) * 2 > alias_slots ? 
+			(alias_slots == 0 ? 16 : alias_slots * 2) : alias_slots);
+	
+	alias.hash = hash_string(key);
+	alias.value = alias_arena_add(value);
+	slot = alias_slot(key, alias.hash);
+	
+	// Check if alias exists
+	if(slot->state == ALIAS_USED) {
+		// Alias already exists, overwrite the value (the old one becomes waste)
+		alias.key = slot->key;
+		alias_discard(slot, false);
+	}
+	else {
+		// Found a free space, insert it here
+		if(slot->state == ALIAS_EMPTY)
+			alias_used++;
+		
+		alias.key = alias_arena_add(key);
+		alias_count++;
+	}
+	
+	*slot = alias;
+	
+	// Any cached expansion may depend on this alias
+	alias_generation++;
+	
+	if(alias_arena_waste > 4096 && alias_arena_waste > alias_arena_length / 2)
+		alias_arena_compact();
+	
+	return true;
+}
+
+/* Remove an alias from the alias list
+   
+   Params:
+   	key - The alias name (e.g. dir)
+   
+   Returns:
+   	If the removal failed, false is returned. Otherwise true.
+ */
+bool alias_remove(const char *key) {
+	alias_t *slot = alias_find(key);
+	
+	if(slot == NULL)
+		return false;
+	
+	// Leave a marker so later slots in the probe sequence are still found
+	alias_discard(slot, true);
+	slot->state = ALIAS_DELETED;
+	
+	alias_count--;
+	alias_generation++;
+	
+	if(alias_arena_waste > 4096 && alias_arena_waste > alias_arena_length / 2)
+		alias_arena_compact();
+	
+	return true;
+}
+
+/* Record how deeply aliases were nested to give the tokens added to the
+   alias output since a point
+   
+   Params:
+   	first - The number of tokens in the output before they were added
+   	output - The alias output
+   	depth - The depth, 0 for tokens that didn't come from an alias
+ */
+void alias_record_depth(int first, const token_vector_t *output, int depth) {
+	if(output->count > alias_token_depths_size) {
+		alias_token_depths_size = output->count * 2;
+		alias_token_depths = realloc(alias_token_depths, 
+			alias_token_depths_size * sizeof(int));
+	}
+	
+	for(int i = first; i < output->count; i++)
+		alias_token_depths[i] = depth;
+	
+	return;
+}
+
+/* Add the full expansion of a list of tokens to the alias output
+   
+   A word in a command position (the first word, or one following a list 
+   separator or a pipe, but not a redirection's target) that names an alias 
+   is replaced by the alias's tokens, which are expanded in turn. As in other 
+   shells, an alias isn't expanded again within its own expansion, which 
+   stops aliases like "alias ls ls -l" from looping forever.
+   
+   Params:
+   	count - The number of tokens
+   	tokens - The tokens to expand
+   	active - The aliases currently being expanded
+   	depth - The number of aliases in active
+   	output - Where to add the tokens
+ */
+void alias_expand_into(int count, char *tokens[], alias_t *active[], int depth,
+	token_vector_t *output) {
+	for(int i = 0; i < count; i++) {
+		alias_t *alias = NULL;
+		
+		if((i == 0 || is_separator(tokens[i - 1]) || tokens[i - 1] == token_pipe) && 
+			!is_operator(tokens[i]))
+			alias = alias_find(tokens[i]);
+		
+		for(int j = 0; alias != NULL && j < depth; j++) {
+			if(active[j] == alias)
+				// Already being expanded, so it's a plain command here
+				alias = NULL;
+		}
+		
+		if(alias == NULL) {
+			token_vector_add(output, tokens[i]);
+			
+			if(depth == 0)
+				alias_record_depth(output->count - 1, output, 0);
+			
+			continue;
+		}
+		
+		if(depth == 0) {
+			// At the top level the cached expansion can be used
+			char **expansion = alias_expansion(alias);
+			int first = output->count;
+			
+			for(int j = 0; j < alias->expansion_count; j++)
+				token_vector_add(output, expansion[j]);
+			
+			alias_record_depth(first, output, alias->expansion_depth);
+			
+			if(alias->expansion_depth > alias_depth)
+				alias_depth = alias->expansion_depth;
+		}
+		else {
+			// Part of building an expansion, so expand the alias's own tokens
+			char *alias_tokens[alias->token_count + 1];
+			
+			active[depth] = alias;
+			
+			if(depth + 1 > alias_depth)
+				alias_depth = depth + 1;
+			
+			alias_decode(alias, alias_tokens);
+			alias_expand_into(alias->token_count, alias_tokens, active, depth + 1, 
+				output);
+		}
+	}
+	
+	return;
+}
+
+/* Get the full expansion of an alias, building it if it isn't cached
+   
+   Params:
+   	alias - The alias
+   	
+   Returns:
+   	The alias's expanded tokens (alias->expansion_count of them), valid until
+   	the aliases are next changed.
+ */
+char **alias_expansion(alias_t *alias) {
+	if(alias->expansion == NULL || alias->expansion_generation != alias_generation) {
+		token_vector_t expansion = { NULL, 0, 0 };
+		alias_t *active[alias_count + 1];
+		int depth = alias_depth;
+		
+		active[0] = alias;
+		alias_depth = 1;
+		
+		{
+			char *alias_tokens[alias->token_count + 1];
+			
+			alias_decode(alias, alias_tokens);
+			alias_expand_into(alias->token_count, alias_tokens, active, 1, &expansion);
+		}
+		
+		free(alias->expansion);
+		alias->expansion = expansion.tokens;
+		alias->expansion_count = expansion.count;
+		alias->expansion_generation = alias_generation;
+		alias->expansion_depth = alias_depth;
+		alias_depth = depth;
+	}
+	
+	return alias->expansion;
+}
+
+/* Get the token strings of an alias's pre-split value
+   
+   Params:
+   	alias - The alias
+   	tokens - Filled in with the alias->token_count token strings, which point 
+   		into the arena, and a terminating NULL
+ */
+void alias_decode(const alias_t *alias, char *tokens[]) {
+	char *position = alias_arena + alias->tokens;
+	
+	for(int i = 0; i < alias->token_count; i++) {
+		char type = *position++;
+		
+		if(type == 0) {
+			tokens[i] = position;
+			position += strlen(position) + 1;
+		}
+		else
+			tokens[i] = operators[type - 1];
+	}
+	
+	tokens[alias->token_count] = NULL;
+	
+	return;
+}
+
+/* Expand the aliases in a line's tokens (see alias_expand_into())
+   
+   Params:
+   	count - The number of tokens
+   	tokens - The tokens, terminated by NULL
+   	expanded - Set to the expanded tokens, terminated by NULL. They're only 
+   		valid until the next call.
+   	depths - Set to how deeply aliases were nested to give each expanded
+   		token, or NULL if no token came from an alias. They're only valid 
+   		until the next call.
+   	
+   Returns:
+   	The number of expanded tokens.
+ */
+int alias_expand(int count, char *tokens[], char ***expanded, int **depths) {
+	static token_vector_t output = { NULL, 0, 0 };
+	
+	alias_ready();
+	alias_depth = 0;
+	*depths = NULL;
+	
+	if(alias_count == 0) {
+		*expanded = tokens;
+		return count;
+	}
+	
+	output.count = 0;
+	alias_expand_into(count, tokens, NULL, 0, &output);
+	token_vector_add(&output, NULL);
+	*expanded = output.tokens;
+	
+	if(alias_depth > 0)
+		*depths = alias_token_depths;
+	
+	return output.count - 1;
+}
+
+/* Output the list of aliases */
+void alias_print() {
+	alias_t **list;
+	
+	if(alias_count == 0) {
+		// No aliases present
+		printf("You have not set any aliases!\n");
+		return;
+	}
+		
+	// There's aliases present, iterate through all valid aliases
+	list = alias_list();
+	
+	for(unsigned int i = 0; i < alias_count; i++)
+		printf("[%u]: '%s' -> '%s'\n", i, alias_arena + list[i]->key, 
+			alias_arena + list[i]->value);
+	
+	free(list);
+	
+	return;
+}
+
+/* Initialise the alias structures */
+void alias_init() {
+	input_t alias_file;
+	token_list_t alias_tokens = { NULL, NULL, 0, 0 };
+	char *line = NULL;
+	size_t line_size = 0;
+	const char *text;
+	size_t length;
+
+	char *alias_path = home_file(".aliases");
+	bool opened = input_open_file(&alias_file, alias_path);
+	
+	free(alias_path);
+	
+	if(!opened)
+		return;
+	
+	// File exists, parse it accordingly
+	while((text = input_getline(&alias_file, &length)) != NULL) {
+		// We've read in a line, copy it out so it can be tokenized
+		if(length + 1 > line_size) {
+			line_size = length + 1;
+			line = realloc(line, line_size);
+		}
+		
+		memcpy(line, text, length);
+		line[length] = '\0';
+		
+		// Do some validity checking...
+		if(!lex_line(line, &alias_tokens) || alias_tokens.count < 3)
+			// This means that there isn't enough arguments to add an alias
+			continue;
+		
+		// The alias value (i.e. command2) is the rest of the line as it was
+		// written, so take it before the line is altered by token_strings()
+		char *command2 = line + alias_tokens.views[2].offset;
+		char *command2_end = line + length;
+		
+		while(command2_end > command2 && (command2_end[-1] == ' ' || 
+			command2_end[-1] == '\t'))
+			command2_end--;
+		
+		*command2_end = '\0';
+		alias_tokens.count = 2;
+		token_strings(line, &alias_tokens);
+		
+		if(strcmp(alias_tokens.words[0], "alias") != 0)
+			continue;
+		
+		// Add the alias
+		alias_add(alias_tokens.words[1], command2);
+	}
+	
+	free(line);
+	token_list_free(&alias_tokens);
+	input_close(&alias_file);
+	
+	return;
+}
+
+/* Load the saved aliases, if they haven't been loaded yet
+   
+   Loading is put off until an alias is first needed, so it doesn't hold up 
+   the first prompt.
+ */
+void alias_ready() {
+	if(!alias_loaded) {
+		alias_loaded = true;
+		alias_init();
+	}
+	
+	return;
+}
+
+/* Save the alias list to the ".aliases" file for alias persistence */
+void save_aliases() {
+	FILE *alias_file;
+	const char *arg1 = "alias";
+	char *alias_path = home_file(".aliases");
+	
+	// Overwrite the old .aliases file
+	alias_file = fopen(alias_path, "w");
+	free(alias_path);
+	
+	if(alias_file == NULL) {
+		perror("error: unable to save aliases");
+		return;
+	}
+	
+	// Iterate through all alias's in the order they were added
+	alias_t **list = alias_list();
+	
+	for(unsigned int i = 0; i < alias_count; i++) {
+		char *arg2 = alias_arena + list[i]->key;
+		char *arg3 = alias_arena + list[i]->value;
+		
+		fprintf(alias_file, "%s %s %s\n", arg1, arg2, arg3);
+	}
+	
+	free(list);
+	fclose(alias_file);
+	
+	return;
+}
@@ -0,0 +1,614 @@
+/*
+ * builtins.c
+ *
+ * CS210 Semester 2 Shell Project
+ *
+ * The builtin commands and the table they are found through.
+ *
+ * Authors:
+ *	Mark Anderson <mark.anderson@strath.ac.uk>
+ *	Andrew Logan <andrew.logan@strath.ac.uk>
+ *	John Meikle <john.meikle@strath.ac.uk>
+ *
+ * Version:
+ *	0.9-stage9
+ *
+ */
+
+#include "shell.h"
+
+/* history internal command */
+void command_history() {
+	// Output the history in ascending numerical order
+	for(int number = history_first; number <= (int)history_count; number++) {
+		char *command = history_get(number);
+		
+		if(command != NULL)
+			printf("%d = %s\n", number, command);
+	}
+
+	return;
+}
+
+/* history -s internal command */
+void command_history_search(const char *text) {
+	int *matches = malloc(history_capacity * sizeof(int));
+	int found = history_search(text, false, matches, history_capacity);
+	
+	// Matches are found newest first, output them in ascending numerical order
+	for(int i = found - 1; i >= 0; i--)
+		printf("%d = %s\n", matches[i], history_get(matches[i]));
+	
+	free(matches);
+	
+	return;
+}
+
+/* unalias internal command
+   
+   Returns:
+   	Whether the alias was removed.
+ */
+bool command_unalias(const char *command) {
+	alias_ready();
+	
+	if(alias_get(command) == NULL) {
+		fprintf(stderr, "error: alias '%s' does not exist\n", command);
+		return false;
+	}
+	
+	// Alias exists, remove it
+	if(!alias_remove(command)) {
+		fprintf(stderr, "error: unable to remove alias '%s'\n", command);
+		return false;
+	}
+	
+	alias_changed = true;
+	
+	return true;
+}
+
+/* alias internal command 
+   
+   To output the alias list, NULL should be passed as the argument(s)
+   
+   Returns:
+   	Whether the aliases were listed or the alias added.
+ */
+bool command_alias(const char *command1, const char *command2) {
+	alias_ready();
+	
+	if(command1 == NULL || command2 == NULL)
+		// Print the list of aliases
+		alias_print();
+	else {
+		// Map an alias
+		if(alias_get(command1) != NULL)
+			// Alias already exists
+			printf("warning: overwriting alias '%s'\n", command1);
+
+		if(!alias_add(command1, command2)) {
+			// Something went wrong when trying to add the alias
+			fprintf(stderr, "error: unable to add alias\n");
+			return false;
+		}
+		
+		alias_changed = true;
+	}
+	
+	return true;
+}
+
+/* cd internal command
+   
+   Returns:
+   	Whether the directory was changed.
+ */
+bool command_cd(const char *path) {
+	if(path == NULL) {
+		fprintf(stderr, "cd: HOME not set\n");
+		return false;
+	}
+	
+	if(chdir(path) == -1) {
+		fprintf(stderr, "%s: no such directory\n", path);
+		return false;
+	}
+	
+	return true;
+}
+
+/* getpath internal command */
+void command_getpath() {
+	printf("%s\n", (env_path_current == NULL) ? "" : env_path_current);
+	
+	return;
+}
+
+/* setpath internal command */
+void command_setpath(const char *path) {
+	// This also clears the cached command locations (see var_changed())
+	var_set("PATH", path, true);
+	
+	return;
+}
+
+/* hash internal command
+   
+   Params:
+   	count - The number of arguments
+   	args - The arguments following "hash"
+ */
+void command_hash(int count, char *args[]) {
+	if(count == 0) {
+		// Output the cached locations along with the cache statistics
+		for(int i = 0; i < PATH_CACHE_SIZE; i++) {
+			for(path_entry_t *entry = path_cache[i]; entry != NULL; entry = entry->next)
+				printf("%u\t%s\n", entry->hits, entry->path);
+		}
+		
+		printf("%lu hits, %lu misses\n", path_cache_hits, path_cache_misses);
+	}
+	else if(count == 1 && strcmp(args[0], "-r") == 0) {
+		// Forget every cached location
+		path_cache_clear();
+	}
+	else {
+		// Prefill the cache with the given commands
+		for(int i = 0; i < count; i++) {
+			char *path;
+			
+			if(strchr(args[i], '/') != NULL || path_cache_find(args[i]) != NULL)
+				continue;
+			
+			if((path = path_search(args[i])) == NULL)
+				fprintf(stderr, "hash: %s: not found\n", args[i]);
+			else if(path[0] != '/')
+				free(path);
+			else
+				path_cache_add(args[i], path);
+		}
+	}
+	
+	return;
+}
+
+/* launcher internal command
+   
+   To output the current launcher, NULL should be passed as the argument
+ */
+void command_launcher(const char *name) {
+	if(name == NULL)
+		printf("%s\n", launcher == LAUNCHER_SPAWN ? "spawn" : "fork");
+	else if(strcmp(name, "spawn") == 0)
+		launcher = LAUNCHER_SPAWN;
+	else if(strcmp(name, "fork") == 0)
+		launcher = LAUNCHER_FORK;
+	else
+		printf("usage: launcher [spawn|fork]\n");
+	
+	return;
+}
+
+/* pwd internal command */
+void command_pwd() {
+	char current_directory[PATH_MAX];
+	
+	getcwd(current_directory, PATH_MAX);
+	printf("%s\n", current_directory);
+	
+	return;
+}
+
+/* timing internal command
+   
+   Params:
+   	mode - "on" to report every command's resource usage, "off" to stop, or 
+   		NULL to print the current mode
+ */
+void command_timing(const char *mode) {
+	if(mode == NULL)
+		printf("%s\n", timing ? "on" : "off");
+	else if(strcmp(mode, "on") == 0)
+		timing = true;
+	else if(strcmp(mode, "off") == 0)
+		timing = false;
+	else
+		printf("usage: timing [on|off]\n");
+	
+	return;
+}
+
+/* help internal command */
+void command_help() {
+	for(int i = 0; builtins[i].name != NULL; i++) {
+		printf("%s\t %s\n", builtins[i].name, builtins[i].description);
+		
+		if(strcmp(builtins[i].name, "history") == 0) {
+			// History invocations aren't commands, but belong with history
+			printf("!<no>\t execute a specific historical command\n");
+			printf("!<text>\t execute the last command starting with some text\n");
+			printf("!?<text>?\t execute the last command containing some text\n");
+			printf("!!\t execute the last command\n");
+		}
+	}
+	
+	return;
+}
+
+/* cd builtin */
+int builtin_cd(int argc, char *argv[]) {
+	if(argc > 2) {
+		printf("usage: cd [dir]\n");
+		return 1;
+	}
+	
+	// cd called by itself sets the home directory, otherwise the one given
+	return command_cd((argc == 1) ? env_home : argv[1]) ? 0 : 1;
+}
+
+/* pwd builtin */
+int builtin_pwd(int argc, char *argv[]) {
+	command_pwd();
+	
+	return 0;
+}
+
+/* getpath builtin */
+int builtin_getpath(int argc, char *argv[]) {
+	command_getpath();
+	
+	return 0;
+}
+
+/* setpath builtin */
+int builtin_setpath(int argc, char *argv[]) {
+	if(argc != 2) {
+		// Needs to be in format setpath <path>
+		printf("usage: setpath <path>\n");
+		return 1;
+	}
+	
+	command_setpath(argv[1]);
+	
+	return 0;
+}
+
+/* history builtin */
+int builtin_history(int argc, char *argv[]) {
+	if(interactive)
+		history_ready();
+	
+	if(argc == 3 && strcmp(argv[1], "-s") == 0)
+		// Search for history containing argv[2]
+		command_history_search(argv[2]);
+	else if(argc != 1) {
+		printf("usage: history [-s <text>]\n");
+		return 1;
+	}
+	else if(history_count == 0) {
+		fprintf(stderr, "error: no history recorded\n");
+		return 1;
+	}
+	else
+		command_history();
+	
+	return 0;
+}
+
+/* alias builtin */
+int builtin_alias(int argc, char *argv[]) {
+	if(argc >= 3) {
+		// Form the arguments into a string, skipping "alias <command1>"
+		char *command_buffer = join_words(argc - 2, argv + 2);
+		bool added = command_alias(argv[1], command_buffer);
+		
+		free(command_buffer);
+		
+		return added ? 0 : 1;
+	}
+	
+	if(argc != 1) {
+		printf("usage: alias [<command1> <command2>]\n");
+		return 1;
+	}
+	
+	command_alias(NULL, NULL);
+	
+	return 0;
+}
+
+/* unalias builtin */
+int builtin_unalias(int argc, char *argv[]) {
+	if(argc != 2) {
+		printf("usage: unalias <command>\n");
+		return 1;
+	}
+	
+	return command_unalias(argv[1]) ? 0 : 1;
+}
+
+/* export builtin */
+int builtin_export(int argc, char *argv[]) {
+	return command_export(argc - 1, argv + 1) ? 0 : 1;
+}
+
+/* unset builtin */
+int builtin_unset(int argc, char *argv[]) {
+	if(argc < 2) {
+		printf("usage: unset <name>...\n");
+		return 1;
+	}
+	
+	return command_unset(argc - 1, argv + 1) ? 0 : 1;
+}
+
+/* exit builtin */
+int builtin_exit(int argc, char *argv[]) {
+	// Exit with the given status, or that of the last command
+	int status = (argc > 1) ? atoi(argv[1]) & 0xff : exit_status;
+	
+	exit_status = status;
+	
+	if(subshell) {
+		// Only leave the child shell running this part of a pipeline
+		fflush(stdout);
+		_exit(status);
+	}
+	
+	cleanup();
+	exit(status);
+}
+
+/* help builtin */
+int builtin_help(int argc, char *argv[]) {
+	command_help();
+	
+	return 0;
+}
+
+/* hash builtin */
+int builtin_hash(int argc, char *argv[]) {
+	command_hash(argc - 1, argv + 1);
+	
+	return 0;
+}
+
+/* launcher builtin */
+int builtin_launcher(int argc, char *argv[]) {
+	if(argc > 2) {
+		printf("usage: launcher [spawn|fork]\n");
+		return 1;
+	}
+	
+	command_launcher(argv[1]);
+	
+	return 0;
+}
+
+/* jobs builtin */
+int builtin_jobs(int argc, char *argv[]) {
+	command_jobs();
+	
+	return 0;
+}
+
+/* fg builtin */
+int builtin_fg(int argc, char *argv[]) {
+	if(argc > 2) {
+		printf("usage: fg [%%job]\n");
+		return 1;
+	}
+	
+	return command_fg(argv[1]);
+}
+
+/* bg builtin */
+int builtin_bg(int argc, char *argv[]) {
+	if(argc > 2) {
+		printf("usage: bg [%%job]\n");
+		return 1;
+	}
+	
+	return command_bg(argv[1]) ? 0 : 1;
+}
+
+/* wait builtin */
+int builtin_wait(int argc, char *argv[]) {
+	return command_wait(argc - 1, argv + 1) ? 0 : 1;
+}
+
+/* time builtin, only reached as a pipeline stage (run_tokens handles a 
+   leading time itself) */
+int builtin_time(int argc, char *argv[]) {
+	return run_tokens(argc, argv);
+}
+
+/* timing builtin */
+int builtin_timing(int argc, char *argv[]) {
+	if(argc > 2) {
+		printf("usage: timing [on|off]\n");
+		return 1;
+	}
+	
+	command_timing(argv[1]);
+	
+	return 0;
+}
+
+/* parallel builtin */
+int builtin_parallel(int argc, char *argv[]) {
+	long limit = sysconf(_SC_NPROCESSORS_ONLN);
+	const char *file = NULL;
+	input_t input;
+	int first = 1;
+	int status;
+	
+	for(; first < argc && argv[first][0] == '-'; first++) {
+		if(strcmp(argv[first], "-j") == 0 && first + 1 < argc)
+			limit = atol(argv[++first]);
+		else if(strcmp(argv[first], "-f") == 0 && first + 1 < argc)
+			file = argv[++first];
+		else if(strcmp(argv[first], "--") == 0) {
+			first++;
+			break;
+		}
+		else
+			limit = 0;
+		
+		if(limit < 1 || limit > 4096) {
+			printf("usage: parallel [-j <jobs>] [-f <file>] [<command>]...\n");
+			return 2;
+		}
+	}
+	
+	if(limit < 1)
+		limit = 1;
+	
+	if(first < argc)
+		// Commands given as arguments
+		return command_parallel((int)limit, argc - first, argv + first, NULL);
+	
+	if(file != NULL && !input_open_file(&input, file)) {
+		perror(file);
+		return 1;
+	}
+	
+	if(file == NULL)
+		input_open_fd(&input, STDIN_FILENO);
+	
+	status = command_parallel((int)limit, 0, NULL, &input);
+	input_close(&input);
+	
+	return status;
+}
+
+/* stats builtin */
+int builtin_stats(int argc, char *argv[]) {
+	if(argc > 2 || (argc == 2 && strcmp(argv[1], "-r") != 0)) {
+		printf("usage: stats [-r]\n");
+		return 1;
+	}
+	
+	command_stats(argc == 2);
+	
+	return 0;
+}
+
+/* telemetry builtin */
+int builtin_telemetry(int argc, char *argv[]) {
+	if(argc > 2) {
+		printf("usage: telemetry [<file>|off]\n");
+		return 1;
+	}
+	
+	return command_telemetry(argv[1]) ? 0 : 1;
+}
+
+// Stores the builtin commands, in the order help lists them
+const builtin_t builtins[] = {
+	{ "history", builtin_history, "display history of commands, or those containing some text (history -s <text>)" },
+	{ "alias", builtin_alias, "print aliases or add an alias" },
+	{ "unalias", builtin_unalias, "remove an alias" },
+	{ "cd", builtin_cd, "change current working directory" },
+	{ "getpath", builtin_getpath, "print system path" },
+	{ "setpath", builtin_setpath, "set system path" },
+	{ "export", builtin_export, "list exported variables, or export some (export <name>[=<value>]...)" },
+	{ "unset", builtin_unset, "remove variables (unset <name>...)" },
+	{ "hash", builtin_hash, "list, prefill (hash <command>...) or clear (hash -r) the command location cache" },
+	{ "jobs", builtin_jobs, "list background and stopped jobs" },
+	{ "fg", builtin_fg, "continue a job in the foreground (fg [%job])" },
+	{ "bg", builtin_bg, "continue a stopped job in the background (bg [%job])" },
+	{ "wait", builtin_wait, "wait for background jobs to complete (wait [%job]...)" },
+	{ "time", builtin_time, "run a command and report its time, maximum resident size and context switches" },
+	{ "timing", builtin_timing, "print or set whether every command's resource usage is reported (on or off)" },
+	{ "echo", builtin_echo, "output its arguments (echo [-neE] [args]...)" },
+	{ "printf", builtin_printf, "output arguments according to a format (printf <format> [args]...)" },
+	{ "test", builtin_test, "check files and compare strings and numbers (test <expression>)" },
+	{ "[", builtin_test, "the same as test, with a closing ] ([ <expression> ])" },
+	{ "true", builtin_true, "do nothing, successfully" },
+	{ "false", builtin_false, "do nothing, unsuccessfully" },
+	{ "command", builtin_command, "run a program rather than a builtin or alias of the same name" },
+	{ "parallel", builtin_parallel, "run commands (given, in a file with -f, or read from input) at most -j <jobs> at a time" },
+	{ "stats", builtin_stats, "print command counts and run time histograms, then reset them with -r" },
+	{ "telemetry", builtin_telemetry, "print, set (telemetry <file>) or stop (telemetry off) the per-command telemetry log" },
+	{ "launcher", builtin_launcher, "print or set how external commands are started (spawn or fork)" },
+	{ "pwd", builtin_pwd, "print current working directory" },
+	{ "help", builtin_help, "list the available internal shell commands" },
+	{ "exit", builtin_exit, "exit the shell, with the last command's status or the one given (exit [n])" },
+	{ NULL, NULL, NULL }
+};
+
+// Stores the builtins by builtin_slot(), which gives each its own slot. This
+// is generated by bench/builtin_table.sh, which has to be run again whenever
+// the builtins change.
+const builtin_t *const builtin_table[BUILTIN_TABLE_SIZE] = {
+	[1] = &builtins[7],	// unset
+	[4] = &builtins[2],	// unalias
+	[15] = &builtins[3],	// cd
+	[20] = &builtins[9],	// jobs
+	[24] = &builtins[18],	// [
+	[34] = &builtins[4],	// getpath
+	[36] = &builtins[21],	// command
+	[46] = &builtins[5],	// setpath
+	[52] = &builtins[12],	// wait
+	[57] = &builtins[8],	// hash
+	[68] = &builtins[23],	// stats
+	[69] = &builtins[27],	// help
+	[74] = &builtins[13],	// time
+	[77] = &builtins[22],	// parallel
+	[79] = &builtins[25],	// launcher
+	[80] = &builtins[14],	// timing
+	[81] = &builtins[26],	// pwd
+	[83] = &builtins[19],	// true
+	[84] = &builtins[16],	// printf
+	[85] = &builtins[17],	// test
+	[88] = &builtins[0],	// history
+	[95] = &builtins[15],	// echo
+	[100] = &builtins[24],	// telemetry
+	[106] = &builtins[1],	// alias
+	[116] = &builtins[11],	// bg
+	[118] = &builtins[20],	// false
+	[120] = &builtins[10],	// fg
+	[121] = &builtins[28],	// exit
+	[125] = &builtins[6],	// export
+};
+
+/* Hash a builtin name
+   
+   The length and the first, second and last characters are used, with the 
+   factors bench/builtin_table.sh found to give every builtin its own slot, so
+   a lookup is a hash and at most one strcmp.
+   
+   Params:
+   	name - The command name
+   	length - The length of the name, which mustn't be 0
+   
+   Returns:
+   	The slot in builtin_table
+ */
+unsigned int builtin_slot(const char *name, size_t length) {
+	return (length * BUILTIN_LENGTH_FACTOR + 
+		(unsigned char)name[0] * BUILTIN_FIRST_FACTOR + (unsigned char)name[1] + 
+		(unsigned char)name[length - 1]) % BUILTIN_TABLE_SIZE;
+}
+
+/* Find the builtin command a command name refers to
+   
+   Params:
+   	name - The command name (e.g. cd)
+   	
+   Returns:
+   	The builtin, or NULL if the command isn't a builtin.
+ */
+const builtin_t *builtin_find(const char *name) {
+	size_t length = strlen(name);
+	const builtin_t *builtin;
+	
+	if(length == 0)
+		return NULL;
+	
+	builtin = builtin_table[builtin_slot(name, length)];
+	
+	return (builtin != NULL && strcmp(builtin->name, name) == 0) ? builtin : NULL;
+}
@@ -0,0 +1,830 @@
+/*
+ * exec.c
+ *
+ * CS210 Semester 2 Shell Project
+ *
+ * Starting commands and pipelines.
+ *
+ * Authors:
+ *	Mark Anderson <mark.anderson@strath.ac.uk>
+ *	Andrew Logan <andrew.logan@strath.ac.uk>
+ *	John Meikle <john.meikle@strath.ac.uk>
+ *
+ * Version:
+ *	0.9-stage9
+ *
+ */
+
+#include "shell.h"
+
+// Stores how external processes are started (see the launcher command)
+launcher_t launcher = LAUNCHER_SPAWN;
+
+// Set when every command's resource usage is reported (see the timing command)
+bool timing = false;
+
+// Stores the exit status of the last command run, which $? expands to
+int exit_status = 0;
+
+/* Get the time from a monotonic clock, for measuring elapsed time
+   
+   Returns:
+   	The time in seconds
+ */
+double clock_seconds() {
+	struct timespec now;
+	
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/* Add one process's resource usage to a total
+   
+   CPU times and context switches are summed, the maximum resident size is the
+   largest of any one process.
+   
+   Params:
+   	total - The total to add to
+   	usage - The usage to add
+ */
+void usage_add(struct rusage *total, const struct rusage *usage) {
+	timeradd(&total->ru_utime, &usage->ru_utime, &total->ru_utime);
+	timeradd(&total->ru_stime, &usage->ru_stime, &total->ru_stime);
+	
+	if(usage->ru_maxrss > total->ru_maxrss)
+		total->ru_maxrss = usage->ru_maxrss;
+	
+	total->ru_nvcsw += usage->ru_nvcsw;
+	total->ru_nivcsw += usage->ru_nivcsw;
+	
+	return;
+}
+
+/* Report the resource usage of a command on standard error
+   
+   Params:
+   	command - The command line
+   	real - The elapsed (wall clock) time in seconds
+   	usage - The resource usage
+   	verbose - Whether to report it a line per figure, for the time command, 
+   		rather than on one line, for the timing mode
+ */
+void usage_report(const char *command, double real, const struct rusage *usage, 
+	bool verbose) {
+	double user = usage->ru_utime.tv_sec + usage->ru_utime.tv_usec / 1e6;
+	double sys = usage->ru_stime.tv_sec + usage->ru_stime.tv_usec / 1e6;
+	
+	// Anything the command wrote should come out before the report
+	fflush(stdout);
+	
+	if(verbose)
+		fprintf(stderr, "\nreal\t%.3fs\nuser\t%.3fs\nsys\t%.3fs\n"
+			"maxrss\t%ld KiB\ncsw\t%ld voluntary, %ld involuntary\n",
+			real, user, sys, usage->ru_maxrss, usage->ru_nvcsw, usage->ru_nivcsw);
+	else
+		fprintf(stderr, "timing: %.3fs real, %.3fs user, %.3fs sys, %ld KiB, "
+			"%ld/%ld csw: %s\n", real, user, sys, usage->ru_maxrss, 
+			usage->ru_nvcsw, usage->ru_nivcsw, command);
+	
+	return;
+}
+
+/* Prepare a child process to become a pipeline stage, used after fork()
+   
+   Params:
+   	setup - How the stage is to be set up
+ */
+void stage_setup_child(const stage_setup_t *setup) {
+	if(setup->pgid != -1) {
+		setpgid(0, setup->pgid);
+		
+		if(setup->foreground)
+			tcsetpgrp(STDIN_FILENO, getpgrp());
+	}
+	
+	// Undo the signal handling that only the shell itself wants
+	signal(SIGINT, SIG_DFL);
+	signal(SIGQUIT, SIG_DFL);
+	signal(SIGTSTP, SIG_DFL);
+	signal(SIGTTIN, SIG_DFL);
+	signal(SIGTTOU, SIG_DFL);
+	
+	if(setup->in != -1)
+		dup2(setup->in, STDIN_FILENO);
+	
+	if(setup->out != -1)
+		dup2(setup->out, STDOUT_FILENO);
+	
+	for(int i = 0; i < setup->redirect_count; i++)
+		dup2(setup->redirect_fds[i], redirect_target(&setup->redirects[i]));
+	
+	return;
+}
+
+/* Start an external program without waiting for it
+   
+   Depending on the launcher setting the program is either started with 
+   posix_spawn(), which avoids copying the shell's page tables, or with a 
+   plain fork() and execve(). Either way it gets the exported variables (see
+   var_environment()) as its environment.
+   
+   Params:
+   	path - The location of the program (see path_lookup())
+   	argv - The array of argument strings, terminated by NULL
+   	setup - How the process is to be set up
+   	
+   Returns:
+   	The process ID of the new process. If it couldn't be started, -1 is
+   	returned and errno describes why.
+ */
+pid_t launch_process(const char *path, char *argv[], const stage_setup_t *setup) {
+	char **envp = var_environment();
+	pid_t new_process;
+	
+	// Flush pending output so it appears before the program's and isn't 
+	// duplicated into a forked child
+	fflush(stdout);
+	
+	if(launcher == LAUNCHER_SPAWN) {
+		posix_spawn_file_actions_t actions;
+		posix_spawnattr_t attributes;
+		sigset_t defaults;
+		short flags = POSIX_SPAWN_SETSIGDEF;
+		int error;
+		
+		posix_spawn_file_actions_init(&actions);
+		posix_spawnattr_init(&attributes);
+		
+		// Undo the signal handling that only the shell itself wants
+		sigemptyset(&defaults);
+		sigaddset(&defaults, SIGINT);
+		sigaddset(&defaults, SIGQUIT);
+		sigaddset(&defaults, SIGTSTP);
+		sigaddset(&defaults, SIGTTIN);
+		sigaddset(&defaults, SIGTTOU);
+		posix_spawnattr_setsigdefault(&attributes, &defaults);
+		
+		if(setup->pgid != -1) {
+			flags |= POSIX_SPAWN_SETPGROUP;
+			posix_spawnattr_setpgroup(&attributes, setup->pgid);
+			
+#ifdef HAVE_SPAWN_TCSETPGRP
+			if(setup->foreground)
+				posix_spawn_file_actions_addtcsetpgrp_np(&actions, STDIN_FILENO);
+#endif
+		}
+		
+		posix_spawnattr_setflags(&attributes, flags);
+		
+		if(setup->in != -1)
+			posix_spawn_file_actions_adddup2(&actions, setup->in, STDIN_FILENO);
+		
+		if(setup->out != -1)
+			posix_spawn_file_actions_adddup2(&actions, setup->out, STDOUT_FILENO);
+		
+		for(int i = 0; i < setup->redirect_count; i++)
+			posix_spawn_file_actions_adddup2(&actions, setup->redirect_fds[i], 
+				redirect_target(&setup->redirects[i]));
+		
+		error = posix_spawn(&new_process, path, &actions, &attributes, argv, 
+			envp);
+		posix_spawn_file_actions_destroy(&actions);
+		posix_spawnattr_destroy(&attributes);
+		
+		if(error != 0) {
+			errno = error;
+			return -1;
+		}
+		
+		return new_process;
+	}
+	
+	// fork() a new child process
+	new_process = fork();
+	
+	if(new_process == 0) {
+		// Child process
+		stage_setup_child(setup);
+		execve(path, argv, envp);
+		
+		// Something went wrong when trying to execute the command
+		perror(argv[0]);
+		_exit(errno == ENOENT ? 127 : 126);
+	}
+	
+	return new_process;
+}
+
+/* Resolve and start an external command without waiting for it
+   
+   Params:
+   	argv - The array of argument strings, terminated by NULL
+   	setup - How the process is to be set up
+   	
+   Returns:
+   	The process ID of the new process. If the command couldn't be started, an
+   	error is output and -1 is returned.
+ */
+pid_t start_process(char *argv[], const stage_setup_t *setup) {
+	pid_t new_process;
+	const char *path;
+	
+	// Resolve the command before starting it so the cache lives in the shell
+	if((path = path_lookup(argv[0])) == NULL) {
+		fprintf(stderr, "%s: command not found\n", argv[0]);
+		return -1;
+	}
+	
+	new_process = launch_process(path, argv, setup);
+	
+	if(new_process < 0 && errno == ENOENT && path != argv[0]) {
+		// The cached location has gone, search PATH again and retry
+		path_cache_remove(argv[0]);
+		
+		if((path = path_lookup(argv[0])) != NULL)
+			new_process = launch_process(path, argv, setup);
+	}
+	
+	if(new_process < 0)
+		// Error occurred
+		fprintf(stderr, "%s: %s\n", argv[0], strerror(errno));
+	
+	return new_process;
+}
+
+/* Start a builtin command in a child shell without waiting for it
+   
+   Params:
+   	argc - The number of arguments
+   	argv - The array of argument strings, terminated by NULL
+   	setup - How the child shell is to be set up
+   	
+   Returns:
+   	The process ID of the child shell, or -1 if it couldn't be created.
+ */
+pid_t start_builtin(int argc, char *argv[], const stage_setup_t *setup) {
+	pid_t new_process;
+	int status;
+	
+	fflush(stdout);
+	new_process = fork();
+	
+	if(new_process < 0)
+		perror("error: fork() failed");
+	else if(new_process == 0) {
+		// Child shell, run the builtin against the pipeline's descriptors
+		subshell = true;
+		job_control = false;
+		stage_setup_child(setup);
+		status = builtin_find(argv[0])->handler(argc, argv);
+		fflush(stdout);
+		_exit(status);
+	}
+	
+	return new_process;
+}
+
+/* Execute a pipeline, with every stage running at the same time
+   
+   Each stage's standard output is connected to the next stage's standard
+   input. Builtin stages are run in a child shell. With job control, the stages
+   share a new process group which is given the terminal while it runs in the
+   foreground.
+   
+   Params:
+   	count - The number of stages
+   	commands - The stages, in order
+   	background - Whether to return without waiting for the pipeline
+   	timed - Whether to report the pipeline's resource usage when it's done
+   	
+   Returns:
+   	The exit status of the last stage, 127 if it couldn't be started (1 if 
+   	that was because of its redirections), or 0 for a background pipeline.
+ */
+int execute_pipeline(int count, command_t commands[], bool background, bool timed) {
+	char *command_line = NULL;
+	size_t line_length = 0;
+	stage_setup_t setup;
+	job_t *job;
+	int in = -1;
+	int status = 0;
+	int unstarted = 127;	// the status if the last stage isn't started
+	bool last_started = false;
+	
+	// Form the command line for the job table
+	for(int i = 0; i < count; i++) {
+		char *stage = join_words(commands[i].argc, commands[i].argv);
+		
+		command_line = realloc(command_line, line_length + strlen(stage) + 4);
+		strcpy(command_line + line_length, (i == 0) ? "" : " | ");
+		strcat(command_line, stage);
+		line_length = strlen(command_line);
+		free(stage);
+		
+		for(int j = 0; j < commands[i].redirect_count; j++) {
+			const redirect_t *redirect = &commands[i].redirects[j];
+			const char *target = (redirect->target == NULL) ? "" : redirect->target;
+			
+			command_line = realloc(command_line, line_length + 
+				strlen(redirect->operator) + strlen(target) + 3);
+			line_length += sprintf(command_line + line_length, " %s%s%s", 
+				redirect->operator, (redirect->target == NULL) ? "" : " ", target);
+		}
+	}
+	
+	job = job_add(count, command_line);
+	job->timed = timed;
+	free(command_line);
+	
+	if(background && !job_control)
+		// Don't let background jobs compete with the shell for input
+		in = open("/dev/null", O_RDONLY | O_CLOEXEC);
+	
+	for(int i = 0; i < count; i++) {
+		int pipe_fds[2] = { -1, -1 };
+		int redirect_fds[commands[i].redirect_count + 1];
+		pid_t stage = -1;
+		
+		if(i < count - 1) {
+			if(pipe(pipe_fds) == -1) {
+				perror("error: pipe() failed");
+				break;
+			}
+			
+			// Only the stages' dup2() copies should outlive an exec
+			fcntl(pipe_fds[0], F_SETFD, FD_CLOEXEC);
+			fcntl(pipe_fds[1], F_SETFD, FD_CLOEXEC);
+		}
+		
+		setup.in = in;
+		setup.out = pipe_fds[1];
+		setup.pgid = job_control ? ((job->pgid == -1) ? 0 : job->pgid) : -1;
+		setup.foreground = !background;
+		setup.redirects = commands[i].redirects;
+		setup.redirect_fds = redirect_fds;
+		setup.redirect_count = commands[i].redirect_count;
+		
+		if(!redirects_open(commands[i].redirect_count, commands[i].redirects, 
+			redirect_fds))
+			unstarted = 1;
+		else {
+			if(!commands[i].external && builtin_find(commands[i].argv[0]) != NULL)
+				stage = start_builtin(commands[i].argc, commands[i].argv, &setup);
+			else
+				stage = start_process(commands[i].argv, &setup);
+			
+			redirects_close(commands[i].redirect_count, commands[i].redirects, 
+				redirect_fds);
+		}
+		
+		if(stage > 0) {
+			job_process_t *process = &job->processes[job->count++];
+			
+			process->pid = stage;
+			process->done = false;
+			process->stopped = false;
+			process->status = 0;
+			memset(&process->usage, 0, sizeof(process->usage));
+			
+			if(job->pgid == -1)
+				job->pgid = stage;
+			
+			if(job_control)
+				// Also set the group here, so it's right whichever runs first
+				setpgid(stage, job->pgid);
+			
+			last_started = (i == count - 1);
+		}
+		
+		// The shell doesn't use the pipe ends itself, so close them now to let
+		// the stages see end of file and broken pipes
+		if(in != -1)
+			close(in);
+		
+		if(pipe_fds[1] != -1)
+			close(pipe_fds[1]);
+		
+		in = pipe_fds[0];
+	}
+	
+	if(in != -1)
+		close(in);
+	
+	telemetry_spawned(&job->record, job->count);
+	
+	if(job->count == 0)
+		// Nothing could be started
+		job_remove(job);
+	else if(background) {
+		if(interactive)
+			printf("[%d] %d\n", job->number, 
+				(int)job->processes[job->count - 1].pid);
+	}
+	else
+		status = job_wait(job);
+	
+	if(!last_started && !background)
+		// The pipeline's status is its last stage's, which never ran
+		status = unstarted;
+	
+	return status;
+}
+
+/* Run a command from its (alias expanded) tokens
+   
+   A leading "time" reports the resource usage of the whole command, which is 
+   why it's handled here rather than only as a builtin.
+   
+   Params:
+	token_count - The number of tokens in the array
+	token_list - The array of token strings
+	
+   Returns:
+   	The command's exit status, 2 for a syntax error.
+ */
+int run_tokens(int token_count, char *token_list[]) {
+	bool timed = false;
+	
+	if(token_count > 0 && strcmp(token_list[0], "time") == 0) {
+		timed = true;
+		token_list++;
+		token_count--;
+	}
+	
+	if(token_count == 0) {
+		if(timed)
+			printf("usage: time <command>\n");
+		
+		return 0;
+	}
+	
+	// A command made only of assignments (NAME=value) sets shell variables
+	for(int i = 0; i < token_count && !timed && is_assignment(token_list[i]); i++) {
+		if(i == token_count - 1) {
+			command_assign(token_count, token_list);
+			return 0;
+		}
+	}
+	
+	// The stages and their redirections are sized by the line, so they're 
+	// allocated rather than put on the stack
+	command_t *commands = malloc(token_count * sizeof(command_t));
+	redirect_t *redirects = malloc(token_count * sizeof(redirect_t));
+	int status = 1;
+	
+	if(commands != NULL && redirects != NULL)
+		status = run_stages(token_count, token_list, commands, redirects, timed);
+	else
+		fprintf(stderr, "error: out of memory\n");
+	
+	free(commands);
+	free(redirects);
+	
+	return status;
+}
+
+/* Split a command's tokens into pipeline stages and run them
+   
+   The words are moved down over the redirections, and each stage's arguments
+   are terminated in place.
+   
+   Params:
+	token_count - The number of tokens in the array
+	token_list - The array of token strings
+	commands - Room for a stage per token
+	redirects - Room for a redirection per token
+	timed - Whether the command was prefixed with "time"
+	
+   Returns:
+   	The command's exit status, 2 for a syntax error.
+ */
+int run_stages(int token_count, char *token_list[], command_t commands[], 
+	redirect_t redirects[], bool timed) {
+	int command_count = 1;
+	int word_count = 0;
+	int redirect_count = 0;
+	bool background = false;
+	const builtin_t *builtin;
+	
+	if(token_list[token_count - 1] == token_background) {
+		// Run in the background
+		token_list[--token_count] = NULL;
+		background = true;
+		
+		if(token_count == 0) {
+			fprintf(stderr, "error: syntax error near '&'\n");
+			return 2;
+		}
+	}
+	
+	commands[0].argc = 0;
+	commands[0].argv = token_list;
+	commands[0].redirects = redirects;
+	commands[0].redirect_count = 0;
+	commands[0].external = false;
+	
+	for(int i = 0; i < token_count; i++) {
+		command_t *command = &commands[command_count - 1];
+		char *token = token_list[i];
+		
+		if(is_redirect(token)) {
+			redirect_t *redirect = &redirects[redirect_count++];
+			
+			redirect->operator = token;
+			redirect->target = NULL;
+			command->redirect_count++;
+			
+			if(token == token_error_output)
+				continue;
+			
+			if(i == token_count - 1 || is_operator(token_list[i + 1])) {
+				fprintf(stderr, "error: syntax error near '%s'\n", token);
+				return 2;
+			}
+			
+			redirect->target = token_list[++i];
+			continue;
+		}
+		
+		if(is_operator(token) && token != token_pipe) {
+			fprintf(stderr, "error: syntax error near '%s'\n", token);
+			return 2;
+		}
+		
+		if(token != token_pipe) {
+			token_list[word_count++] = token;
+			command->argc++;
+			continue;
+		}
+		
+		if(command->argc == 0 || i == token_count - 1) {
+			fprintf(stderr, "error: syntax error near '|'\n");
+			return 2;
+		}
+		
+		token_list[word_count++] = NULL;
+		commands[command_count].argc = 0;
+		commands[command_count].argv = token_list + word_count;
+		commands[command_count].redirects = redirects + redirect_count;
+		commands[command_count].redirect_count = 0;
+		commands[command_count].external = false;
+		command_count++;
+	}
+	
+	token_list[word_count] = NULL;
+	
+	// "command <command>" runs a program even if there's a builtin of the same
+	// name (and it isn't the first word, so it hasn't been alias expanded)
+	for(int i = 0; i < command_count; i++) {
+		if(commands[i].argc > 1 && strcmp(commands[i].argv[0], "command") == 0) {
+			commands[i].argv++;
+			commands[i].argc--;
+			commands[i].external = true;
+		}
+	}
+	
+	if(commands[command_count - 1].argc == 0) {
+		int *fds;
+		bool opened;
+		
+		if(command_count > 1) {
+			fprintf(stderr, "error: syntax error near '|'\n");
+			return 2;
+		}
+		
+		if((fds = malloc((redirect_count + 1) * sizeof(int))) == NULL) {
+			fprintf(stderr, "error: out of memory\n");
+			return 1;
+		}
+		
+		// Only redirections, so just create (or check) the files
+		if((opened = redirects_open(redirect_count, redirects, fds)))
+			redirects_close(redirect_count, redirects, fds);
+		
+		free(fds);
+		
+		return opened ? 0 : 1;
+	}
+	
+	if(command_count == 1 && !background && !commands[0].external && 
+		(builtin = builtin_find(token_list[0])) != NULL) {
+		struct rusage before, after, usage;
+		telemetry_record_t record;
+		int argc = commands[0].argc;
+		double started = 0;
+		int saved[3];
+		int status;
+		
+		telemetry_start(&record, TELEMETRY_BUILTIN);
+		telemetry_command(&record, argc, token_list);
+		telemetry_spawned(&record, 0);
+		
+		// Builtins run in the shell, so their redirections are made by the 
+		// shell, and undone once they're done
+		if(!redirects_swap(redirect_count, redirects, saved)) {
+			telemetry_finish(&record, 1);
+			return 1;
+		}
+		
+		if(timed || timing) {
+			// Their usage is the shell's own usage while they ran
+			getrusage(RUSAGE_SELF, &before);
+			started = clock_seconds();
+		}
+		
+		status = builtin->handler(argc, token_list);
+		redirects_restore(saved);
+		telemetry_finish(&record, status);
+		
+		if(!timed && !timing)
+			return status;
+		
+		getrusage(RUSAGE_SELF, &after);
+		usage = after;
+		timersub(&after.ru_utime, &before.ru_utime, &usage.ru_utime);
+		timersub(&after.ru_stime, &before.ru_stime, &usage.ru_stime);
+		usage.ru_nvcsw -= before.ru_nvcsw;
+		usage.ru_nivcsw -= before.ru_nivcsw;
+		
+		char *command = join_words(argc, token_list);
+		
+		usage_report(command, clock_seconds() - started, &usage, timed);
+		free(command);
+		
+		return status;
+	}
+	
+	// Anything else is run as a job, including unsupported internal 
+	// commands which we must assume are external commands
+	return execute_pipeline(command_count, commands, background, timed);
+}
+
+/* Check whether a word needs expanding by expand_word()
+   
+   Params:
+   	word - The word
+   	
+   Returns:
+   	If the word has a $, a pattern character or a quoted character in it,
+   	true is returned. Otherwise false.
+ */
+bool is_expandable(const char *word) {
+	return strpbrk(word, EXPANDED_CHARACTERS MARKED_CHARACTERS) != NULL;
+}
+
+/* Expand a word: its variables first, then, if it's a file name pattern that
+   matches anything, the matching paths take its place
+   
+   Params:
+   	word - The word
+   	pattern - Whether the word can be a pattern
+   	words - The vector to add the resulting words to
+   	copies - The vector to add the words that were allocated to, which must
+   		be freed
+ */
+void expand_word(char *word, bool pattern, token_vector_t *words, 
+	token_vector_t *copies) {
+	if(is_operator(word) || !is_expandable(word)) {
+		token_vector_add(words, word);
+		return;
+	}
+	
+	if(strpbrk(word, "$" MARKED_CHARACTERS) != NULL) {
+		word = var_expand(word);
+		token_vector_add(copies, word);
+	}
+	
+	// Assignments aren't taken as patterns either
+	if(pattern && !is_assignment(word)) {
+		int count = words->count;
+		
+		if(glob_expand(word, words) > 0) {
+			for(int i = count; i < words->count; i++)
+				token_vector_add(copies, words->tokens[i]);
+			
+			return;
+		}
+	}
+	
+	unquote_word(word);
+	token_vector_add(words, word);
+	
+	return;
+}
+
+/* Run a command list, whose commands are separated by ; (run one after the 
+   other), & (run the command before it in the background), && (run the next
+   command only if the last succeeded) and || (only if it failed)
+   
+   The whole list is checked before any of it runs, so a syntax error runs 
+   nothing. A skipped command leaves the exit status alone, so in a && b || c,
+   c runs if either a or b failed. Variables (and $?) and file name patterns
+   are expanded as each command runs, so an assignment is seen by the 
+   commands after it.
+   
+   Params:
+	token_count - The number of tokens in the array
+	token_list - The array of token strings
+	depths - How deeply aliases were nested to give each token, or NULL if
+		none came from an alias (see alias_expand())
+	
+   Returns:
+   	The exit status of the last command run, which is also left in 
+   	exit_status.
+ */
+int run_list(int token_count, char *token_list[], const int depths[]) {
+	char *separator = token_semicolon;	// the separator before the command
+	int start = 0;
+	
+	char *unexpected = NULL;
+	
+	// Every separator must follow a command, and && or || must be followed by
+	// one too
+	for(int i = 0; i < token_count && unexpected == NULL; i++) {
+		if(!is_separator(token_list[i]))
+			continue;
+		
+		if(i == start)
+			unexpected = token_list[i];
+		
+		start = i + 1;
+	}
+	
+	if(unexpected == NULL && token_count > 0 && 
+		(token_list[token_count - 1] == token_and || token_list[token_count - 1] == token_or))
+		unexpected = token_list[token_count - 1];
+	
+	if(unexpected != NULL) {
+		fprintf(stderr, "error: syntax error near '%s'\n", unexpected);
+		return exit_status = 2;
+	}
+	
+	start = 0;
+	
+	for(int i = 0; i <= token_count; i++) {
+		char *token = (i < token_count) ? token_list[i] : NULL;
+		int count = i - start;
+		
+		if(token != NULL && !is_separator(token))
+			continue;
+		
+		if(token == token_background)
+			// run_tokens() takes the & as running the command in the background
+			count++;
+		
+		if(count > 0 && !(separator == token_and && exit_status != 0) &&
+			!(separator == token_or && exit_status == 0)) {
+			token_vector_t words = { NULL, 0, 0 };
+			token_vector_t copies = { NULL, 0, 0 };
+			
+			// Redirection targets aren't taken as patterns, they have to 
+			// stay one word
+			for(int j = 0; j < count; j++)
+				expand_word(token_list[start + j], 
+					j == 0 || !is_redirect(token_list[start + j - 1]), &words, &copies);
+			
+			token_vector_add(&words, NULL);
+			
+			// The command is recorded as coming from the most deeply nested 
+			// alias any of its tokens came from
+			telemetry_alias_depth = 0;
+			
+			for(int j = 0; depths != NULL && j < count; j++) {
+				if(depths[start + j] > telemetry_alias_depth)
+					telemetry_alias_depth = depths[start + j];
+			}
+			
+			exit_status = run_tokens(words.count - 1, words.tokens);
+			telemetry_alias_depth = 0;
+			
+			for(int j = 0; j < copies.count; j++)
+				free(copies.tokens[j]);
+			
+			free(words.tokens);
+			free(copies.tokens);
+		}
+		
+		separator = token;
+		start = i + 1;
+	}
+	
+	return exit_status;
+}
+
+/* Parse the tokenized input and perform the relevant and appropriate operation(s)
+   
+   Params:
+	token_count - The number of tokens in the array
+	token_list - The array of token strings
+ */
+void parse_tokens(int token_count, char *token_list[]) {
+	int *depths;
+	
+	// Replace any aliases with their (cached) expansions
+	token_count = alias_expand(token_count, token_list, &token_list, &depths);
+	
+	run_list(token_count, token_list, depths);
+	
+	return;
+}
@@ -0,0 +1,530 @@
+/*
+ * glob.c
+ *
+ * CS210 Semester 2 Shell Project
+ *
+ * File name pattern (*, ? and [...]) expansion, with a cache of directory
+ * listings.
+ *
+ * Authors:
+ *	Mark Anderson <mark.anderson@strath.ac.uk>
+ *	Andrew Logan <andrew.logan@strath.ac.uk>
+ *	John Meikle <john.meikle@strath.ac.uk>
+ *
+ * Version:
+ *	0.9-stage9
+ *
+ */
+
+#include "shell.h"
+
+// Only for the d_type values (e.g. DT_DIR), it would redefine PATH_MAX in
+// shell.h
+#include <dirent.h>
+
+// Stores the cached directory listings, the least recently used is replaced
+glob_dir_t glob_cache[GLOB_CACHE_SIZE];
+unsigned long glob_clock = 0;
+
+// Stores the number of listings that were and weren't found in the cache
+unsigned long glob_cache_hits = 0;
+unsigned long glob_cache_misses = 0;
+
+// Stores the names of the listing being sorted, for glob_entry_compare()
+const char *glob_sort_names = NULL;
+
+/* Find the end of a bracket expression ([abc], [a-z], [!abc] or [^abc]),
+   which can't span a /
+   
+   Params:
+   	pattern - The pattern, starting at the [
+   
+   Returns:
+   	The closing ], or NULL if there isn't one, in which case the [ is just a
+   	character.
+ */
+const char *glob_bracket_end(const char *pattern) {
+	const char *c = pattern + 1;
+	
+	if(*c == '!' || *c == '^')
+		c++;
+	
+	// A ] straight after the [ is part of the set
+	if(*c == ']')
+		c++;
+	
+	while(*c != '\0' && *c != '/' && *c != ']')
+		c++;
+	
+	return (*c == ']') ? c : NULL;
+}
+
+/* Check whether part of a word is a pattern, quoted characters don't count
+   
+   Params:
+   	pattern - The start of the part
+   	end - The end of the part
+   
+   Returns:
+   	If it has a *, ? or [...] in it, true is returned. Otherwise false.
+ */
+bool glob_has_pattern(const char *pattern, const char *end) {
+	for(const char *c = pattern; c < end; c++) {
+		const char *close;
+		
+		if(*c == '*' || *c == '?')
+			return true;
+		
+		if(*c == '[' && (close = glob_bracket_end(c)) != NULL && close < end)
+			return true;
+	}
+	
+	return false;
+}
+
+/* Match one character of a name against the start of a pattern that isn't a *
+   
+   Params:
+   	pattern - The pattern, moved past what was matched
+   	end - The end of the pattern
+   	c - The character
+   
+   Returns:
+   	Whether the character matches.
+ */
+bool glob_match_one(const char **pattern, const char *end, char c) {
+	const char *p = *pattern;
+	const char *close;
+	
+	if(*p == '?') {
+		*pattern = p + 1;
+		return true;
+	}
+	
+	if(*p == '[' && (close = glob_bracket_end(p)) != NULL && close < end) {
+		bool negate = (p[1] == '!' || p[1] == '^');
+		bool matched = false;
+		
+		for(p += 1 + negate; p < close; ) {
+			unsigned char low = unquote_character(*p);
+			unsigned char high = low;
+			
+			if(p[1] == '-' && p + 2 < close) {
+				high = unquote_character(p[2]);
+				p += 3;
+			}
+			else
+				p++;
+			
+			if((unsigned char)c >= low && (unsigned char)c <= high)
+				matched = true;
+		}
+		
+		*pattern = close + 1;
+		return matched != negate;
+	}
+	
+	*pattern = p + 1;
+	
+	return unquote_character(*p) == c;
+}
+
+/* Match a name against one part of a pattern (between slashes)
+   
+   A * is matched by going back to the last one and letting it take one more
+   character, so a match never takes more than the pattern's length times the
+   name's.
+   
+   Params:
+   	pattern - The start of the pattern
+   	end - The end of the pattern
+   	name - The name
+   
+   Returns:
+   	Whether the name matches.
+ */
+bool glob_match(const char *pattern, const char *end, const char *name) {
+	const char *star = NULL;
+	const char *resume = NULL;
+	
+	while(*name != '\0') {
+		if(pattern < end && *pattern == '*') {
+			star = ++pattern;
+			resume = name;
+			continue;
+		}
+		
+		if(pattern < end && glob_match_one(&pattern, end, *name)) {
+			name++;
+			continue;
+		}
+		
+		if(star == NULL)
+			return false;
+		
+		pattern = star;
+		name = ++resume;
+	}
+	
+	while(pattern < end && *pattern == '*')
+		pattern++;
+	
+	return pattern == end;
+}
+
+/* Compare two entries of the listing being sorted by name, for qsort()
+   
+   Params:
+   	a - The first entry
+   	b - The second entry
+   
+   Returns:
+   	Less than, equal to or greater than 0 as the first name sorts before,
+   	the same as or after the second (in byte order).
+ */
+int glob_entry_compare(const void *a, const void *b) {
+	const glob_entry_t *entry_a = a;
+	const glob_entry_t *entry_b = b;
+	
+	if(entry_a->key != entry_b->key)
+		return (entry_a->key > entry_b->key) - (entry_a->key < entry_b->key);
+	
+	if((entry_a->key & 0xff) == 0)
+		// Both names are shorter than 8 bytes, so they're the same
+		return 0;
+	
+	return strcmp(glob_sort_names + entry_a->name + 8, glob_sort_names + entry_b->name + 8);
+}
+
+/* Read a directory's listing, sorted by name, with getdents64() into a large
+   buffer rather than readdir()'s one entry at a time
+   
+   Params:
+   	dir - The listing to fill in, which must be empty
+   	path - The directory
+   
+   Returns:
+   	Whether the directory could be read.
+ */
+bool glob_read(glob_dir_t *dir, const char *path) {
+	static char buffer[GLOB_BUFFER];
+	buffer_t names = { NULL, 0, 0 };
+	int size = 0;
+	struct stat info;
+	long length;
+	int fd;
+	
+	if((fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC)) == -1)
+		return false;
+	
+	// The time is taken first, so a change made while reading is after it
+	clock_gettime(CLOCK_REALTIME, &dir->read);
+	fstat(fd, &info);
+	dir->device = info.st_dev;
+	dir->inode = info.st_ino;
+	dir->modified = info.st_mtim;
+	dir->count = 0;
+	
+	while((length = syscall(SYS_getdents64, fd, buffer, sizeof(buffer))) > 0) {
+		for(long offset = 0; offset < length; ) {
+			glob_dirent_t *entry = (glob_dirent_t *)(buffer + offset);
+			const char *name = entry->d_name;
+			
+			offset += entry->d_reclen;
+			
+			if(name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+				continue;
+			
+			if(dir->count == size) {
+				size = (size == 0) ? 256 : size * 2;
+				dir->entries = realloc(dir->entries, size * sizeof(glob_entry_t));
+			}
+			
+			size_t length = strlen(name);
+			
+			dir->entries[dir->count].name = names.length;
+			dir->entries[dir->count].length = length;
+			dir->entries[dir->count++].type = entry->d_type;
+			buffer_append(&names, name, length + 1);
+		}
+	}
+	
+	close(fd);
+	dir->names = names.data;
+	
+	// Sort on the first 8 bytes of each name, big endian so the keys sort
+	// the same way as the names
+	for(int i = 0; i < dir->count; i++) {
+		const unsigned char *name = (const unsigned char *)names.data + dir->entries[i].name;
+		uint64_t key = 0;
+		
+		for(int j = 0; j < 8; j++) {
+			key <<= 8;
+			
+			if(*name != '\0')
+				key |= *name++;
+		}
+		
+		dir->entries[i].key = key;
+	}
+	
+	glob_sort_names = dir->names;
+	qsort(dir->entries, dir->count, sizeof(glob_entry_t), glob_entry_compare);
+	
+	return true;
+}
+
+/* Get the listing of a directory, from the cache if it hasn't changed
+   
+   A cached listing is used if the directory's modification time is the same
+   as when it was read. A change made within GLOB_RACY seconds before the
+   listing was read may not have changed the time (it's only so precise), so
+   such a listing is read again rather than trusted.
+   
+   Params:
+   	path - The directory
+   
+   Returns:
+   	The listing, or NULL if the directory couldn't be read.
+ */
+glob_dir_t *glob_listing(const char *path) {
+	glob_dir_t *dir = NULL;
+	glob_dir_t *oldest = NULL;
+	struct stat info;
+	
+	if(stat(path, &info) == -1 || !S_ISDIR(info.st_mode))
+		return NULL;
+	
+	for(int i = 0; i < GLOB_CACHE_SIZE; i++) {
+		glob_dir_t *cached = &glob_cache[i];
+		
+		if(cached->path != NULL && strcmp(cached->path, path) == 0) {
+			dir = cached;
+			break;
+		}
+		
+		if(cached->busy == 0 && (oldest == NULL || cached->used < oldest->used))
+			oldest = cached;
+	}
+	
+	if(dir != NULL) {
+		double age = (dir->read.tv_sec - info.st_mtim.tv_sec) +
+			(dir->read.tv_nsec - info.st_mtim.tv_nsec) / 1e9;
+		
+		dir->used = ++glob_clock;
+		
+		if(dir->device == info.st_dev && dir->inode == info.st_ino &&
+			dir->modified.tv_sec == info.st_mtim.tv_sec &&
+			dir->modified.tv_nsec == info.st_mtim.tv_nsec && age >= GLOB_RACY) {
+			glob_cache_hits++;
+			return dir;
+		}
+		
+		if(dir->busy > 0)
+			// It's being walked, which can only be through a link back to
+			// itself, so leave it as it is
+			return dir;
+	}
+	else if(oldest == NULL)
+		// Every listing is being walked
+		return NULL;
+	else {
+		dir = oldest;
+		free(dir->path);
+		dir->path = malloc(strlen(path) + 1);
+		strcpy(dir->path, path);
+		dir->used = ++glob_clock;
+	}
+	
+	glob_cache_misses++;
+	free(dir->names);
+	dir->names = NULL;
+	
+	if(!glob_read(dir, path)) {
+		free(dir->path);
+		dir->path = NULL;
+		dir->count = 0;
+		return NULL;
+	}
+	
+	return dir;
+}
+
+/* Find the entries of a listing that start with the characters a pattern
+   starts with, before any *, ? or [, by a binary search of the sorted names
+   
+   Params:
+   	dir - The listing
+   	pattern - The pattern
+   	end - The end of the pattern
+   	first - Set to the first entry that could match
+   	last - Set to after the last entry that could match
+ */
+void glob_range(glob_dir_t *dir, const char *pattern, const char *end, int *first,
+	int *last) {
+	char prefix[end - pattern + 1];
+	size_t length = 0;
+	
+	while(pattern + length < end && strchr("*?[", pattern[length]) == NULL) {
+		prefix[length] = unquote_character(pattern[length]);
+		length++;
+	}
+	
+	*first = 0;
+	*last = dir->count;
+	
+	if(length == 0)
+		return;
+	
+	for(int high = dir->count; *first < high; ) {
+		int middle = *first + (high - *first) / 2;
+		
+		if(strncmp(dir->names + dir->entries[middle].name, prefix, length) < 0)
+			*first = middle + 1;
+		else
+			high = middle;
+	}
+	
+	for(int low = *first; low < *last; ) {
+		int middle = low + (*last - low) / 2;
+		
+		if(strncmp(dir->names + dir->entries[middle].name, prefix, length) <= 0)
+			low = middle + 1;
+		else
+			*last = middle;
+	}
+	
+	return;
+}
+
+/* Expand the rest of a pattern, one part (between slashes) at a time
+   
+   Params:
+   	path - The path matched so far, ending in a / unless it's empty
+   	pattern - The rest of the pattern
+   	matches - The vector to add the matching paths to, newly allocated
+ */
+void glob_walk(buffer_t *path, const char *pattern, token_vector_t *matches) {
+	const char *end = strchrnul(pattern, '/');
+	size_t length = path->length;
+	glob_dir_t *dir;
+	struct stat info;
+	int first, last;
+	
+	if(!glob_has_pattern(pattern, end)) {
+		// A part without a pattern only has to be there
+		for(const char *c = pattern; c < end; c++) {
+			char literal = unquote_character(*c);
+			
+			buffer_append(path, &literal, 1);
+		}
+		
+		if(*end == '/') {
+			buffer_append(path, "/", 1);
+			glob_walk(path, end + 1, matches);
+		}
+		else {
+			buffer_append(path, "", 1);
+			
+			if(lstat(path->data, &info) == 0)
+				token_vector_add(matches, strcpy(malloc(path->length), path->data));
+		}
+		
+		path->length = length;
+		return;
+	}
+	
+	buffer_append(path, "", 1);
+	dir = glob_listing((length == 0) ? "." : path->data);
+	path->length = length;
+	
+	if(dir == NULL)
+		return;
+	
+	// A name can only match if it ends with what follows the last *, when
+	// that's plain characters, which is quicker to check first
+	const char *tail = end;
+	
+	while(tail > pattern && tail[-1] != '*')
+		tail--;
+	
+	char suffix[end - tail + 1];
+	size_t suffix_length = 0;
+	
+	if(tail > pattern && !glob_has_pattern(tail, end)) {
+		for(const char *c = tail; c < end; c++)
+			suffix[suffix_length++] = unquote_character(*c);
+	}
+	
+	dir->busy++;
+	glob_range(dir, pattern, end, &first, &last);
+	
+	for(int i = first; i < last; i++) {
+		const glob_entry_t *entry = &dir->entries[i];
+		const char *name = dir->names + entry->name;
+		
+		// Hidden files are only matched by a pattern starting with a .
+		if(name[0] == '.' && pattern[0] != '.')
+			continue;
+		
+		if(entry->length < suffix_length || memcmp(name + entry->length - suffix_length, 
+			suffix, suffix_length) != 0 || !glob_match(pattern, end, name))
+			continue;
+		
+		path->length = length;
+		buffer_append(path, name, strlen(name) + 1);
+		
+		if(*end == '\0') {
+			token_vector_add(matches, strcpy(malloc(path->length), path->data));
+			continue;
+		}
+		
+		// Anything followed by a / has to be a directory, links and entries
+		// of unknown type have to be looked at to find out
+		if(entry->type == DT_LNK || entry->type == DT_UNKNOWN) {
+			if(stat(path->data, &info) == -1 || !S_ISDIR(info.st_mode))
+				continue;
+		}
+		else if(entry->type != DT_DIR)
+			continue;
+		
+		path->data[path->length - 1] = '/';
+		
+		if(end[1] == '\0') {
+			buffer_append(path, "", 1);
+			token_vector_add(matches, strcpy(malloc(path->length), path->data));
+		}
+		else
+			glob_walk(path, end + 1, matches);
+	}
+	
+	dir->busy--;
+	path->length = length;
+	
+	return;
+}
+
+/* Expand a word that's a file name pattern
+   
+   Params:
+   	word - The word, which may have quoted characters (see quote_character())
+   		in it, which are only matched as themselves
+   	matches - The vector to add the matching paths to, in order, each newly
+   		allocated
+   
+   Returns:
+   	The number of matching paths, 0 if there are none (or the word isn't a
+   	pattern).
+ */
+int glob_expand(const char *word, token_vector_t *matches) {
+	buffer_t path = { NULL, 0, 0 };
+	int count = matches->count;
+	
+	if(!glob_has_pattern(word, word + strlen(word)))
+		return 0;
+	
+	glob_walk(&path, word, matches);
+	free(path.data);
+	
+	return matches->count - count;
+}
@@ -0,0 +1,643 @@
+/*
+ * history.c
+ *
+ * CS210 Semester 2 Shell Project
+ *
+ * The command history: its ring of entries, search index and log.
+ *
+ * Authors:
+ *	Mark Anderson <mark.anderson@strath.ac.uk>
+ *	Andrew Logan <andrew.logan@strath.ac.uk>
+ *	John Meikle <john.meikle@strath.ac.uk>
+ *
+ * Version:
+ *	0.9-stage9
+ *
+ */
+
+#include "shell.h"
+
+// Stores the historical elements, in a ring indexed by number % capacity
+history_t *history_value = NULL;
+int history_capacity = HISTORY_DEFAULT;
+
+// Stores the number of historical elements, and the oldest one still held
+unsigned int history_count = 0;
+unsigned int history_first = 1;
+
+// Stores the history strings, in a ring of slabs which are reused in turn
+char **history_slabs = NULL;
+int history_slab_count = 0;
+int history_slab = 0;
+size_t history_slab_used = 0;
+
+// Stores the history index, the posting list for each trigram hash, and how
+// many commands have been indexed since stale numbers were last swept out
+history_posting_t history_index[HISTORY_INDEX_SIZE];
+int history_index_added = 0;
+
+// Stores whether the entries in the history log have been loaded
+bool history_loaded = false;
+
+// Stores the history log, which commands are appended to as they are run, and
+// its size and lines (the lines are only counted once the history is loaded)
+int history_log_fd = -1;
+size_t history_log_size = 0;
+unsigned int history_log_lines = 0;
+
+/* Get the history index slot for a trigram
+   
+   Params:
+   	a, b, c - The trigram's characters, a leading 0 marks the start of a 
+   		command
+   
+   Returns:
+   	The slot in history_index
+ */
+unsigned int history_trigram(unsigned char a, unsigned char b, unsigned char c) {
+	unsigned int trigram = ((unsigned int)a << 16) | ((unsigned int)b << 8) | c;
+	
+	return (trigram * 2654435761u) >> 18;
+}
+
+/* Remove the numbers of entries no longer held from the front of a posting 
+   list
+   
+   Params:
+   	posting - The posting list
+ */
+void history_posting_trim(history_posting_t *posting) {
+	while(posting->start < posting->count && 
+		posting->numbers[posting->start] < (int)history_first)
+		posting->start++;
+	
+	if(posting->start > 0 && posting->start >= posting->count / 2) {
+		// Most of the list is stale, so move the rest back to the start
+		posting->count -= posting->start;
+		memmove(posting->numbers, posting->numbers + posting->start, 
+			posting->count * sizeof(int));
+		posting->start = 0;
+	}
+	
+	return;
+}
+
+/* Add a command to the history index
+   
+   Every trigram of the command is indexed, along with its first one and two 
+   characters (as trigrams starting with 0), so both substrings of three or 
+   more characters and prefixes of any length can be looked up.
+   
+   Params:
+   	number - The command's history number
+   	command - The command
+ */
+void history_index_add(int number, const char *command) {
+	unsigned char a = 0, b = 0;
+	
+	for(const unsigned char *c = (const unsigned char *)command; *c != '\0'; c++) {
+		history_posting_t *posting = &history_index[history_trigram(a, b, *c)];
+		
+		history_posting_trim(posting);
+		
+		// A command can hash to the same slot more than once, only list it once
+		if(posting->count == 0 || posting->numbers[posting->count - 1] != number) {
+			if(posting->count == posting->size) {
+				posting->size = (posting->size == 0) ? 4 : posting->size * 2;
+				posting->numbers = realloc(posting->numbers, posting->size * sizeof(int));
+			}
+			
+			posting->numbers[posting->count++] = number;
+		}
+		
+		a = b;
+		b = *c;
+	}
+	
+	if(++history_index_added >= history_capacity && 
+		history_index_added >= HISTORY_INDEX_SIZE) {
+		// Sweep stale numbers out of the lists that haven't been added to, so
+		// the index stays in proportion to the history held (but not so often
+		// a small history spends its time sweeping)
+		for(int i = 0; i < HISTORY_INDEX_SIZE; i++)
+			history_posting_trim(&history_index[i]);
+		
+		history_index_added = 0;
+	}
+	
+	return;
+}
+
+/* Drop every entry, older than a given number, which has its string in a slab
+   
+   Slabs are filled in order, so the entries stored in the slab about to be 
+   reused are always the oldest ones.
+   
+   Params:
+   	slab - The slab about to be reused
+   	number - The number of the entry being stored
+ */
+void history_slab_clear(const char *slab, int number) {
+	for(; (int)history_first < number; history_first++) {
+		history_t *entry = &history_value[history_first % history_capacity];
+		
+		if(entry->number != (int)history_first || entry->string == NULL)
+			// Record is empty, skip it
+			continue;
+		
+		if(!entry->owned && (entry->string < slab || entry->string >= slab + HISTORY_SLAB_SIZE))
+			// Reached the entries in the next slab
+			break;
+		
+		if(entry->owned)
+			free(entry->string);
+		
+		entry->string = NULL;
+	}
+	
+	return;
+}
+
+/* Allocate space for a history string from the slabs
+   
+   Params:
+   	length - The space needed, at most HISTORY_SLAB_SIZE
+   	number - The number of the entry being stored
+   
+   Returns:
+   	The space allocated
+ */
+char *history_slab_alloc(size_t length, int number) {
+	char *string;
+	
+	if(history_slabs[history_slab] == NULL)
+		history_slabs[history_slab] = malloc(HISTORY_SLAB_SIZE);
+	else if(history_slab_used + length > HISTORY_SLAB_SIZE) {
+		// Move on to the next slab, dropping the entries it still holds
+		history_slab = (history_slab + 1) % history_slab_count;
+		history_slab_used = 0;
+		
+		if(history_slabs[history_slab] == NULL)
+			history_slabs[history_slab] = malloc(HISTORY_SLAB_SIZE);
+		else
+			history_slab_clear(history_slabs[history_slab], number);
+	}
+	
+	string = history_slabs[history_slab] + history_slab_used;
+	history_slab_used += length;
+	
+	return string;
+}
+
+/* Add a command to the in-memory history
+   
+   Params:
+   	number - The command's history number
+   	command - The command, which is copied
+ */
+void history_store(int number, const char *command) {
+	history_t *entry = &history_value[number % history_capacity];
+	size_t length = strlen(command) + 1;
+	
+	// Drop the entry this one replaces in the ring
+	if(entry->owned)
+		free(entry->string);
+	
+	entry->string = NULL;
+	
+	if(length > HISTORY_SLAB_SIZE) {
+		// Too long for a slab, so it gets its own allocation
+		entry->string = malloc(length);
+		entry->owned = true;
+	}
+	else {
+		entry->string = history_slab_alloc(length, number);
+		entry->owned = false;
+	}
+	
+	memcpy(entry->string, command, length);
+	entry->number = number;
+	
+	if(number - history_capacity + 1 > (int)history_first)
+		history_first = number - history_capacity + 1;
+	
+	history_index_add(number, entry->string);
+	
+	return;
+}
+
+/* Fetch a command from the history
+   
+   Params:
+   	number - The command's history number
+   
+   Returns:
+   	The command, or NULL if it isn't held
+ */
+char *history_get(int number) {
+	history_t *entry;
+	
+	if(number < (int)history_first || number > (int)history_count)
+		return NULL;
+	
+	entry = &history_value[number % history_capacity];
+	
+	if(entry->number != number)
+		return NULL;
+	
+	return entry->string;
+}
+
+/* Fetch the most recent command, at or before a history number, that isn't 
+   itself a history invocation
+   
+   Params:
+   	number - The history number to search back from
+   
+   Returns:
+   	The command, or NULL if there isn't one
+ */
+char *history_previous(int number) {
+	for(; number >= (int)history_first; number--) {
+		char *command = history_get(number);
+		
+		if(command != NULL && command[0] != '!')
+			return command;
+	}
+	
+	return NULL;
+}
+
+/* Search the history for commands starting with, or containing, some text
+   
+   The candidates come from the shortest posting list out of the text's 
+   trigrams, and are checked against the text newest first. Substrings shorter
+   than three characters have no trigram, so the whole history is checked.
+   
+   Params:
+   	text - The text to search for
+   	prefix - Whether commands must start with the text, rather than contain it
+   	matches - Array the matching history numbers are stored in, newest first
+   	max - The most matches to store
+   
+   Returns:
+   	The number of matches stored
+ */
+int history_search(const char *text, bool prefix, int matches[], int max) {
+	const unsigned char *c = (const unsigned char *)text;
+	size_t length = strlen(text);
+	history_posting_t *best = NULL;
+	unsigned char a = 0, b = 0;
+	int found = 0;
+	
+	if(!prefix && length >= 3) {
+		a = c[0];
+		b = c[1];
+		c += 2;
+	}
+	
+	if(prefix || length >= 3) {
+		for(; *c != '\0'; c++) {
+			history_posting_t *posting = &history_index[history_trigram(a, b, *c)];
+			
+			if(best == NULL || posting->count - posting->start < best->count - best->start)
+				best = posting;
+			
+			a = b;
+			b = *c;
+		}
+	}
+	
+	if(best == NULL) {
+		// Nothing to narrow the search down, so check every entry
+		for(int number = history_count; number >= (int)history_first && found < max; number--) {
+			char *command = history_get(number);
+			
+			if(command != NULL && (prefix ? strncmp(command, text, length) == 0 :
+				strstr(command, text) != NULL))
+				matches[found++] = number;
+		}
+		
+		return found;
+	}
+	
+	for(int i = best->count - 1; i >= best->start && found < max; i--) {
+		char *command = history_get(best->numbers[i]);
+		
+		if(command != NULL && (prefix ? strncmp(command, text, length) == 0 :
+			strstr(command, text) != NULL))
+			matches[found++] = best->numbers[i];
+	}
+	
+	return found;
+}
+
+/* Open the history log for appending */
+void history_log_open() {
+	char *history_path = home_file(".hist_list");
+	struct stat info;
+	
+	history_log_fd = open(history_path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 
+		0600);
+	
+	if(history_log_fd == -1)
+		perror("warning: unable to record history");
+	else if(fstat(history_log_fd, &info) == 0)
+		history_log_size = info.st_size;
+	
+	free(history_path);
+	
+	return;
+}
+
+/* Rewrite the history log so it only holds the commands in memory
+   
+   The new log is written alongside the old one and renamed over it, so the 
+   log is never left half written.
+ */
+void history_log_compact() {
+	char *history_path = home_file(".hist_list");
+	char *temporary_path = home_file(".hist_list.tmp");
+	FILE *history_file = fopen(temporary_path, "w");
+	
+	if(history_file == NULL) {
+		perror("warning: unable to compact history");
+		free(history_path);
+		free(temporary_path);
+		return;
+	}
+	
+	history_log_lines = 0;
+	
+	// Save the history in ascending order
+	for(int number = history_first; number <= (int)history_count; number++) {
+		char *command = history_get(number);
+		
+		if(command == NULL)
+			// Record is empty, skip it
+			continue;
+		
+		fprintf(history_file, "%d %s\n", number, command);
+		history_log_lines++;
+	}
+	
+	if(fclose(history_file) != 0 || rename(temporary_path, history_path) == -1)
+		perror("warning: unable to compact history");
+	else {
+		// Append to the new log from now on
+		if(history_log_fd != -1)
+			close(history_log_fd);
+		
+		history_log_open();
+	}
+	
+	free(history_path);
+	free(temporary_path);
+	
+	return;
+}
+
+/* Append a command to the history log with a single write
+   
+   The log isn't synced, it only needs to survive the shell crashing or being
+   killed, which the kernel takes care of once the write returns.
+   
+   Params:
+   	number - The command's history number
+   	command - The command
+ */
+void history_log_append(int number, const char *command) {
+	static char *line = NULL;
+	static size_t line_size = 0;
+	size_t length = strlen(command) + 16;
+	size_t written = 0;
+	
+	if(history_log_fd == -1)
+		return;
+	
+	if(history_loaded && history_log_lines >= 2 * (unsigned int)history_capacity)
+		// The log holds twice what's kept in memory, so cut it back down
+		history_log_compact();
+	
+	if(length > line_size) {
+		line_size = length;
+		line = realloc(line, line_size);
+	}
+	
+	length = sprintf(line, "%d %s\n", number, command);
+	
+	while(written < length) {
+		ssize_t result = write(history_log_fd, line + written, length - written);
+		
+		if(result == -1 && errno == EINTR)
+			continue;
+		
+		if(result == -1) {
+			perror("warning: unable to record history");
+			close(history_log_fd);
+			history_log_fd = -1;
+			return;
+		}
+		
+		written += result;
+	}
+	
+	history_log_size += length;
+	history_log_lines++;
+	
+	return;
+}
+
+/* Record a command in the history, both in memory and in the history log
+   
+   The log is only compacted once the history is loaded, so a session that 
+   never loads it does so once the log is large enough that it may need it.
+   
+   Params:
+   	command - The command line
+ */
+void history_add(const char *command) {
+	if(!history_loaded && 
+		history_log_size >= 2 * (size_t)history_capacity * HISTORY_AVERAGE)
+		history_ready();
+	
+	history_count++;
+	
+	if(history_loaded)
+		// Otherwise it's picked up from the log when the history is loaded
+		history_store(history_count, command);
+	
+	history_log_append(history_count, command);
+	
+	return;
+}
+
+/* Load the entries of the command history from the history log
+   
+   Only the last history_capacity entries of the log are wanted, so when the 
+   log can be mapped into memory it is scanned backwards for them rather than 
+   read from the start.
+ */
+void history_load() {
+	input_t history_file;
+	const char *line;
+	size_t length;
+	char *command = NULL;
+	size_t command_size = 0;
+	int max = 0;
+
+	char *history_path = home_file(".hist_list");
+	bool opened = input_open_file(&history_file, history_path);
+	
+	free(history_path);
+
+	// Initialise the history to empty, with enough slabs to hold the capacity
+	// at the average command length (and never fewer than two, so the slab 
+	// being filled is never the one cleared)
+	history_log_lines = 0;
+	history_value = calloc(history_capacity, sizeof(history_t));
+	history_slab_count = (int)(((size_t)history_capacity * HISTORY_AVERAGE) / HISTORY_SLAB_SIZE) + 2;
+	history_slabs = calloc(history_slab_count, sizeof(char *));
+
+	if(opened && history_file.mapped) {
+		// Find the start of the wanted entries, and whether the log has grown
+		// past the point where it should be compacted
+		size_t tail = history_file.end;
+		int lines = 0;
+		
+		if(tail > 0 && history_file.buffer[tail - 1] == '\n')
+			tail--;
+		
+		while(tail > 0 && lines <= 2 * history_capacity) {
+			char *newline = memrchr(history_file.buffer, '\n', tail);
+			
+			if(newline == NULL) {
+				tail = 0;
+				lines++;
+				break;
+			}
+			
+			tail = newline - history_file.buffer;
+			
+			if(++lines == history_capacity)
+				history_file.start = tail + 1;
+		}
+		
+		history_log_lines = lines;
+	}
+
+	while(opened && (line = input_getline(&history_file, &length)) != NULL) {
+		// Line has been read, only need to extract in format of 
+		// <number> <command>
+		const char *end = line + length;
+		int number = 0;
+
+		while(line < end && *line >= '0' && *line <= '9')
+			number = number * 10 + (*line++ - '0');
+
+		while(line < end && (*line == ' ' || *line == '\t'))
+			line++;
+
+		if(number <= 0 || line == end) {
+			// Skip the particular entry if the number or command is invalid
+			fprintf(stderr, "error: invalid entry in .hist_list, skipping...\n");
+			continue;
+		}
+
+		if((size_t)(end - line) >= command_size) {
+			// The log isn't trusted to hold sane lengths, so a command is only 
+			// copied into a buffer grown up to HISTORY_ENTRY_LIMIT
+			char *grown = NULL;
+
+			if(end - line < HISTORY_ENTRY_LIMIT)
+				grown = realloc(command, end - line + 1);
+
+			if(grown == NULL) {
+				fprintf(stderr, "error: overlong entry in .hist_list, skipping...\n");
+				continue;
+			}
+
+			command = grown;
+			command_size = end - line + 1;
+		}
+
+		// Everything seems to have went well and we have formed a history entry
+		// Insert history entry into the history array
+		memcpy(command, line, end - line);
+		command[end - line] = '\0';
+		history_store(number, command);
+
+		if(!history_file.mapped)
+			history_log_lines++;
+
+		// Check if number is max so we can keep track of highest history number
+		if(number > max)
+			max = number;
+	}
+
+	// Set the history_count to the highest history number so as to preserve the number count
+	if(max > (int)history_count)
+		history_count = max;
+
+	if(opened)
+		input_close(&history_file);
+
+	free(command);
+
+	return;
+}
+
+/* Load the entries of the command history, if they haven't been loaded yet */
+void history_ready() {
+	if(!history_loaded) {
+		history_loaded = true;
+		history_load();
+	}
+	
+	return;
+}
+
+/* Initialise the command history
+   
+   Carrying on numbering and logging commands only needs the number of the last
+   one, so that is all that is read from the log. The entries themselves are 
+   loaded when they are first needed (see history_ready).
+ */
+void history_init() {
+	input_t history_file;
+	char *history_path = home_file(".hist_list");
+	bool opened = input_open_file(&history_file, history_path);
+	int number = 0;
+	
+	free(history_path);
+	
+	if(opened && history_file.mapped) {
+		// Read the number from the start of the last line
+		const char *start = history_file.buffer;
+		const char *end = start + history_file.end;
+		const char *line;
+		
+		while(end > start && end[-1] == '\n')
+			end--;
+		
+		line = memrchr(start, '\n', end - start);
+		line = (line == NULL) ? start : line + 1;
+		
+		while(line < end && *line >= '0' && *line <= '9')
+			number = number * 10 + (*line++ - '0');
+	}
+	
+	if(opened)
+		input_close(&history_file);
+	
+	if(number > 0)
+		history_count = number;
+	else if(opened)
+		// The log can't be mapped, or ends with a bad entry, so there's no 
+		// shortcut to the last number
+		history_ready();
+	
+	history_log_open();
+	
+	return;
+}
@@ -0,0 +1,171 @@
+/*
+ * input.c
+ *
+ * CS210 Semester 2 Shell Project
+ *
+ * Input sources: reading command lines from a descriptor, a string or a
+ * (mapped) file.
+ *
+ * Authors:
+ *	Mark Anderson <mark.anderson@strath.ac.uk>
+ *	Andrew Logan <andrew.logan@strath.ac.uk>
+ *	John Meikle <john.meikle@strath.ac.uk>
+ *
+ * Version:
+ *	0.9-stage9
+ *
+ */
+
+#include "shell.h"
+
+/* Set up an input that reads from a file descriptor in large blocks
+   
+   Params:
+   	input - The input to set up
+   	fd - The descriptor to read from
+ */
+void input_open_fd(input_t *input, int fd) {
+	input->fd = fd;
+	input->size = INPUT_CHUNK;
+	input->buffer = malloc(input->size);
+	input->start = 0;
+	input->end = 0;
+	input->mapped = false;
+	
+	return;
+}
+
+/* Set up an input that reads from a string
+   
+   Params:
+   	input - The input to set up
+   	string - The lines to read, they are copied
+ */
+void input_open_string(input_t *input, const char *string) {
+	input->fd = -1;
+	input->size = strlen(string);
+	input->buffer = malloc(input->size + 1);
+	strcpy(input->buffer, string);
+	input->start = 0;
+	input->end = input->size;
+	input->mapped = false;
+	
+	return;
+}
+
+/* Set up an input that reads from a file, mapping it into memory if possible
+   
+   Params:
+   	input - The input to set up
+   	path - The file to read
+   	
+   Returns:
+   	If the file couldn't be opened, false is returned. Otherwise true.
+ */
+bool input_open_file(input_t *input, const char *path) {
+	struct stat info;
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	
+	if(fd == -1)
+		return false;
+	
+	if(fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+		void *data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		
+		if(data != MAP_FAILED) {
+			close(fd);
+			madvise(data, info.st_size, MADV_SEQUENTIAL);
+			
+			input->fd = -1;
+			input->buffer = data;
+			input->size = info.st_size;
+			input->start = 0;
+			input->end = info.st_size;
+			input->mapped = true;
+			
+			return true;
+		}
+	}
+	
+	// Can't be mapped (e.g. a pipe), read it in blocks instead
+	input_open_fd(input, fd);
+	
+	return true;
+}
+
+/* Get the next line from an input
+   
+   Params:
+   	input - The input to read from
+   	length - Set to the length of the line, not including the new line
+   	
+   Returns:
+   	The start of the line, which is not terminated and is only valid until the
+   	next call. At the end of the input NULL is returned.
+ */
+const char *input_getline(input_t *input, size_t *length) {
+	char *line = input->buffer + input->start;
+	char *newline;
+	
+	while((newline = memchr(line, '\n', input->end - input->start)) == NULL) {
+		ssize_t got;
+		
+		if(input->fd == -1)
+			break;
+		
+		// Need more data, move the partial line to the front of the buffer and
+		// make room for a whole block
+		memmove(input->buffer, line, input->end - input->start);
+		input->end -= input->start;
+		input->start = 0;
+		
+		if(input->size - input->end < INPUT_CHUNK) {
+			input->size *= 2;
+			input->buffer = realloc(input->buffer, input->size);
+		}
+		
+		line = input->buffer;
+		got = read(input->fd, input->buffer + input->end, input->size - input->end);
+		
+		if(got < 0 && errno == EINTR)
+			continue;
+		
+		if(got <= 0)
+			break;
+		
+		input->end += got;
+	}
+	
+	if(newline == NULL) {
+		// No more new lines, so whatever is left is the last line
+		if(input->start == input->end)
+			return NULL;
+		
+		*length = input->end - input->start;
+		input->start = input->end;
+		
+		return line;
+	}
+	
+	*length = newline - line;
+	input->start += *length + 1;
+	
+	return line;
+}
+
+/* Release an input
+   
+   Params:
+   	input - The input to release
+ */
+void input_close(input_t *input) {
+	if(input->mapped)
+		munmap(input->buffer, input->size);
+	else
+		free(input->buffer);
+	
+	if(input->fd > STDERR_FILENO)
+		close(input->fd);
+	
+	return;
+}
@@ -0,0 +1,513 @@
+/*
+ * jobs.c
+ *
+ * CS210 Semester 2 Shell Project
+ *
+ * Job control: the job table and the jobs, fg, bg and wait commands.
+ *
+ * Authors:
+ *	Mark Anderson <mark.anderson@strath.ac.uk>
+ *	Andrew Logan <andrew.logan@strath.ac.uk>
+ *	John Meikle <john.meikle@strath.ac.uk>
+ *
+ * Version:
+ *	0.9-stage9
+ *
+ */
+
+#include "shell.h"
+
+// Stores the job table, indexed by job number - 1
+job_t *jobs = NULL;
+int job_slots = 0;
+
+// Set by the SIGCHLD handler when the job table needs updating
+volatile sig_atomic_t child_changed = 0;
+
+// Stores a pipe the SIGCHLD handler writes a byte to, to wake up a poll() for
+// child processes (see command_parallel()), -1 for none
+volatile sig_atomic_t child_wakeup = -1;
+
+// Set when the shell manages process groups and the terminal for its jobs
+bool job_control = false;
+pid_t shell_pgid;
+
+/* Mark a job's process as having changed state
+   
+   Params:
+   	process - The process that changed state
+   	status - The status reported by wait4()
+ */
+void job_process_update(job_process_t *process, int status) {
+	if(WIFSTOPPED(status))
+		process->stopped = true;
+	else if(WIFCONTINUED(status))
+		process->stopped = false;
+	else {
+		process->done = true;
+		process->stopped = false;
+		process->status = status;
+	}
+	
+	return;
+}
+
+/* Wait for a job's process to change state, collecting its resource usage 
+   once it's done
+   
+   Params:
+   	process - The process to wait for
+   	options - The options to pass to wait4()
+   	
+   Returns:
+   	The result of wait4()
+ */
+pid_t job_process_wait(job_process_t *process, int options) {
+	struct rusage usage;
+	int status;
+	pid_t result = wait4(process->pid, &status, options, &usage);
+	
+	if(result > 0) {
+		job_process_update(process, status);
+		
+		if(process->done)
+			process->usage = usage;
+	}
+	
+	return result;
+}
+
+/* Report the resource usage of a completed job, summed over its processes
+   
+   Params:
+   	job - The job to report on
+ */
+void job_report(const job_t *job) {
+	struct rusage total;
+	
+	memset(&total, 0, sizeof(total));
+	
+	for(int i = 0; i < job->count; i++)
+		usage_add(&total, &job->processes[i].usage);
+	
+	usage_report(job->command, clock_seconds() - job->started, &total, job->timed);
+	
+	return;
+}
+
+/* Check the state of a job
+   
+   Params:
+   	job - The job to check
+   	
+   Returns:
+   	JOB_DONE if all of the job's processes have completed, JOB_STOPPED if any 
+   	remaining process is stopped, and JOB_RUNNING otherwise.
+ */
+job_state_t job_state(const job_t *job) {
+	bool done = true;
+	
+	for(int i = 0; i < job->count; i++) {
+		if(job->processes[i].stopped)
+			return JOB_STOPPED;
+		
+		if(!job->processes[i].done)
+			done = false;
+	}
+	
+	return done ? JOB_DONE : JOB_RUNNING;
+}
+
+/* Get the exit status of a completed job, which is that of its last process
+   
+   Params:
+   	job - The job, which must have at least one process
+   	
+   Returns:
+   	The exit status, or 128 + the signal number if it was killed by a signal.
+ */
+int job_status(const job_t *job) {
+	int status = job->processes[job->count - 1].status;
+	
+	if(WIFSIGNALED(status))
+		return 128 + WTERMSIG(status);
+	
+	return WEXITSTATUS(status);
+}
+
+/* Add a new job to the job table
+   
+   Params:
+   	count - The number of processes the job will have
+   	command - The command line the job runs
+   	
+   Returns:
+   	The new job, with no processes started yet.
+ */
+job_t *job_add(int count, const char *command) {
+	int slot = 0;
+	
+	// Use the lowest free job number
+	while(slot < job_slots && jobs[slot].number != 0)
+		slot++;
+	
+	if(slot == job_slots) {
+		// Job table is full, so make it bigger
+		job_slots = (job_slots == 0) ? 8 : job_slots * 2;
+		jobs = realloc(jobs, job_slots * sizeof(job_t));
+		
+		for(int i = slot; i < job_slots; i++)
+			jobs[i].number = 0;
+	}
+	
+	jobs[slot].number = slot + 1;
+	jobs[slot].pgid = -1;
+	jobs[slot].processes = malloc(count * sizeof(job_process_t));
+	jobs[slot].count = 0;
+	jobs[slot].command = malloc(strlen(command) + 1);
+	strcpy(jobs[slot].command, command);
+	jobs[slot].timed = false;
+	jobs[slot].started = clock_seconds();
+	
+	char *words[] = { jobs[slot].command };
+	
+	telemetry_start(&jobs[slot].record, TELEMETRY_EXTERNAL);
+	telemetry_command(&jobs[slot].record, 1, words);
+	
+	return &jobs[slot];
+}
+
+/* Remove a job from the job table, recording its telemetry first if it
+   completed, and reporting its resource usage if it's being timed
+   
+   Params:
+   	job - The job to remove
+ */
+void job_remove(job_t *job) {
+	if(job->count > 0 && job_state(job) == JOB_DONE) {
+		telemetry_finish(&job->record, job_status(job));
+		
+		if(job->timed || timing)
+			job_report(job);
+	}
+	
+	free(job->processes);
+	free(job->command);
+	job->number = 0;
+	
+	return;
+}
+
+/* Find a job from a job specification (e.g. %1, 1 or a process ID)
+   
+   Params:
+   	spec - The job specification, NULL means the most recent job
+   	
+   Returns:
+   	The job, or NULL if no job matches.
+ */
+job_t *job_find(const char *spec) {
+	int number;
+	
+	if(spec == NULL) {
+		// Use the highest numbered job
+		for(int i = job_slots - 1; i >= 0; i--) {
+			if(jobs[i].number != 0)
+				return &jobs[i];
+		}
+		
+		return NULL;
+	}
+	
+	number = atoi((spec[0] == '%') ? spec + 1 : spec);
+	
+	if(number <= 0)
+		return NULL;
+	
+	// Prefer a job number, otherwise look for a matching process ID
+	if(number <= job_slots && jobs[number - 1].number == number)
+		return &jobs[number - 1];
+	
+	if(spec[0] == '%')
+		return NULL;
+	
+	for(int i = 0; i < job_slots; i++) {
+		for(int j = 0; jobs[i].number != 0 && j < jobs[i].count; j++) {
+			if(jobs[i].processes[j].pid == number)
+				return &jobs[i];
+		}
+	}
+	
+	return NULL;
+}
+
+/* Collect the status of any job processes that have changed state, without
+   blocking. Only the job table's own process IDs are waited on. */
+void jobs_update() {
+	child_changed = 0;
+	
+	for(int i = 0; i < job_slots; i++) {
+		if(jobs[i].number == 0)
+			continue;
+		
+		for(int j = 0; j < jobs[i].count; j++) {
+			job_process_t *process = &jobs[i].processes[j];
+			
+			if(!process->done)
+				job_process_wait(process, WNOHANG | WUNTRACED | WCONTINUED);
+		}
+	}
+	
+	return;
+}
+
+/* Report background jobs that have finished and remove them from the table */
+void jobs_notify() {
+	if(child_changed)
+		jobs_update();
+	
+	for(int i = 0; i < job_slots; i++) {
+		if(jobs[i].number != 0 && job_state(&jobs[i]) == JOB_DONE) {
+			if(interactive)
+				printf("[%d]  Done\t\t%s\n", jobs[i].number, jobs[i].command);
+			
+			job_remove(&jobs[i]);
+		}
+	}
+	
+	return;
+}
+
+/* Wait for a job to complete or stop, giving it the terminal meanwhile
+   
+   Params:
+   	job - The job to wait for, it is removed from the table if it completes
+   	
+   Returns:
+   	The job's exit status (see job_status()), or 128 + SIGTSTP if it stopped.
+ */
+int job_wait(job_t *job) {
+	int status = 128 + SIGTSTP;
+	
+	if(job_control)
+		tcsetpgrp(STDIN_FILENO, job->pgid);
+	
+	for(int i = 0; i < job->count; i++) {
+		job_process_t *process = &job->processes[i];
+		
+		while(!process->done && !process->stopped) {
+			if(job_process_wait(process, WUNTRACED) <= 0 && errno != EINTR)
+				// The process has already been reaped, treat it as done
+				process->done = true;
+		}
+	}
+	
+	if(job_control)
+		// Take the terminal back
+		tcsetpgrp(STDIN_FILENO, shell_pgid);
+	
+	if(job_state(job) == JOB_STOPPED)
+		printf("\n[%d]+ Stopped\t\t%s\n", job->number, job->command);
+	else {
+		status = job_status(job);
+		job_remove(job);
+	}
+	
+	return status;
+}
+
+/* Resume a stopped job
+   
+   Params:
+   	job - The job to continue
+ */
+void job_continue(job_t *job) {
+	for(int i = 0; i < job->count; i++)
+		job->processes[i].stopped = false;
+	
+	if(job_control)
+		kill(-job->pgid, SIGCONT);
+	else {
+		for(int i = 0; i < job->count; i++) {
+			if(!job->processes[i].done)
+				kill(job->processes[i].pid, SIGCONT);
+		}
+	}
+	
+	return;
+}
+
+/* jobs internal command */
+void command_jobs() {
+	static const char *state_names[] = { "Running", "Stopped", "Done" };
+	
+	jobs_update();
+	
+	for(int i = 0; i < job_slots; i++) {
+		if(jobs[i].number == 0)
+			continue;
+		
+		job_state_t state = job_state(&jobs[i]);
+		
+		printf("[%d]  %s\t\t%s\n", jobs[i].number, state_names[state], 
+			jobs[i].command);
+		
+		if(state == JOB_DONE)
+			job_remove(&jobs[i]);
+	}
+	
+	return;
+}
+
+/* fg internal command
+   
+   Params:
+   	spec - The job specification, NULL for the most recent job
+   	
+   Returns:
+   	The job's exit status (see job_wait()), or 1 if there's no such job.
+ */
+int command_fg(const char *spec) {
+	job_t *job = job_find(spec);
+	
+	if(job == NULL) {
+		fprintf(stderr, "fg: %s: no such job\n", spec == NULL ? "current" : spec);
+		return 1;
+	}
+	
+	printf("%s\n", job->command);
+	job_continue(job);
+	
+	return job_wait(job);
+}
+
+/* bg internal command
+   
+   Params:
+   	spec - The job specification, NULL for the most recent job
+   
+   Returns:
+   	Whether the job was found.
+ */
+bool command_bg(const char *spec) {
+	job_t *job = job_find(spec);
+	
+	if(job == NULL) {
+		fprintf(stderr, "bg: %s: no such job\n", spec == NULL ? "current" : spec);
+		return false;
+	}
+	
+	printf("[%d]+ %s &\n", job->number, job->command);
+	job_continue(job);
+	
+	return true;
+}
+
+/* wait internal command
+   
+   Params:
+   	count - The number of job specifications
+   	specs - The jobs to wait for, if there are none then all jobs are waited on
+   
+   Returns:
+   	Whether every job asked for was found.
+ */
+bool command_wait(int count, char *specs[]) {
+	bool found = true;
+	
+	for(int i = 0; i < count; i++) {
+		if(job_find(specs[i]) == NULL) {
+			fprintf(stderr, "wait: %s: no such job\n", specs[i]);
+			found = false;
+		}
+	}
+	
+	for(int i = 0; i < job_slots; i++) {
+		job_t *job = &jobs[i];
+		
+		if(job->number == 0)
+			continue;
+		
+		if(count > 0) {
+			// Only wait on the jobs that were asked for
+			bool wanted = false;
+			
+			for(int j = 0; j < count; j++) {
+				if(job_find(specs[j]) == job)
+					wanted = true;
+			}
+			
+			if(!wanted)
+				continue;
+		}
+		
+		for(int j = 0; j < job->count; j++) {
+			while(!job->processes[j].done) {
+				if(job_process_wait(&job->processes[j], 0) <= 0 && errno != EINTR)
+					job->processes[j].done = true;
+			}
+		}
+		
+		job_remove(job);
+	}
+	
+	return found;
+}
+
+/* Handle SIGCHLD by noting that the job table needs updating
+   
+   Params:
+   	signal_number - The signal received (SIGCHLD)
+ */
+void sigchld_handler(int signal_number) {
+	int saved_errno = errno;
+	
+	(void)signal_number;
+	child_changed = 1;
+	
+	if(child_wakeup != -1)
+		write(child_wakeup, "", 1);
+	
+	errno = saved_errno;
+	
+	return;
+}
+
+/* Set up signal handling and, for an interactive shell, job control */
+void job_control_init() {
+	struct sigaction action;
+	
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = sigchld_handler;
+	action.sa_flags = SA_RESTART;
+	sigemptyset(&action.sa_mask);
+	sigaction(SIGCHLD, &action, NULL);
+	
+	if(!interactive || !isatty(STDIN_FILENO))
+		return;
+	
+	// Wait until the shell is in the foreground before taking control
+	while(tcgetpgrp(STDIN_FILENO) != (shell_pgid = getpgrp()))
+		kill(-shell_pgid, SIGTTIN);
+	
+	// The terminal's job control signals are for the foreground job only
+	signal(SIGINT, SIG_IGN);
+	signal(SIGQUIT, SIG_IGN);
+	signal(SIGTSTP, SIG_IGN);
+	signal(SIGTTIN, SIG_IGN);
+	signal(SIGTTOU, SIG_IGN);
+	
+	// Put the shell in its own process group and take the terminal
+	shell_pgid = getpid();
+	
+	if(setpgid(shell_pgid, shell_pgid) == -1 && errno != EPERM) {
+		perror("warning: unable to enable job control");
+		return;
+	}
+	
+	shell_pgid = getpgrp();
+	tcsetpgrp(STDIN_FILENO, shell_pgid);
+	job_control = true;
+	
+	return;
+}
@@ -0,0 +1,396 @@
+/*
+ * lexer.c
+ *
+ * CS210 Semester 2 Shell Project
+ *
+ * The lexer, which splits a line into words and operators.
+ *
+ * Authors:
+ *	Mark Anderson <mark.anderson@strath.ac.uk>
+ *	Andrew Logan <andrew.logan@strath.ac.uk>
+ *	John Meikle <john.meikle@strath.ac.uk>
+ *
+ * Version:
+ *	0.9-stage9
+ *
+ */
+
+#include "shell.h"
+
+// Operators, which token_strings() uses to represent operator tokens so they
+// can be told apart from (quoted) words with the same text
+char token_and[] = "&&";
+char token_or[] = "||";
+char token_pipe[] = "|";
+char token_background[] = "&";
+char token_semicolon[] = ";";
+char token_input[] = "<";
+char token_output[] = ">";
+char token_append[] = ">>";
+char token_error[] = "2>";
+char token_error_output[] = "2>&1";
+
+// Set while a script is being compiled, whose errors are only reported once
+// the line that has them is run (see script_compile())
+bool lexer_quiet = false;
+
+// Stores the operators the lexer recognises, longest first
+char *operators[] = { token_error_output, token_and, token_or, token_append, 
+	token_error, token_pipe, token_background, token_semicolon, token_input, 
+	token_output, NULL };
+
+/* Find the operator, if any, that a piece of text starts with
+   
+   Params:
+   	text - The text to check
+   	
+   Returns:
+   	The operator's token string (e.g. token_pipe), or NULL if the text doesn't 
+   	start with an operator.
+ */
+char *operator_match(const char *text) {
+	for(int i = 0; operators[i] != NULL; i++) {
+		size_t length = strlen(operators[i]);
+		
+		if(strncmp(text, operators[i], length) == 0)
+			return operators[i];
+	}
+	
+	return NULL;
+}
+
+/* Check whether a token string is an operator rather than a word
+   
+   Params:
+   	token - The token string
+   	
+   Returns:
+   	If the token is an operator, true is returned. Otherwise false.
+ */
+bool is_operator(const char *token) {
+	for(int i = 0; operators[i] != NULL; i++) {
+		if(token == operators[i])
+			return true;
+	}
+	
+	return false;
+}
+
+/* Check whether a token string separates the commands of a list (;, &, && 
+   or ||)
+   
+   Params:
+   	token - The token string
+   	
+   Returns:
+   	If the token is a list separator, true is returned. Otherwise false.
+ */
+bool is_separator(const char *token) {
+	return token == token_and || token == token_or || token == token_semicolon || 
+		token == token_background;
+}
+
+/* Split a line into tokens, without changing or copying it
+   
+   Words are separated by blanks and operators. Within a word, quotes and 
+   backslashes stop blanks, operators and the other quote from being special.
+   A # at the start of a word begins a comment that runs to the end of the line.
+   
+   Params:
+   	line - The line to split
+   	list - The token list to fill in, any previous tokens are discarded
+   	
+   Returns:
+   	If a quote isn't closed, an error is output (unless lexer_quiet is set) 
+   	and false is returned. Otherwise true.
+ */
+bool lex_line(const char *line, token_list_t *list) {
+	size_t i = 0;
+	
+	list->count = 0;
+	
+	while(1) {
+		token_t *token;
+		
+		// Skip the blanks between tokens
+		while(line[i] == ' ' || line[i] == '\t' || line[i] == '\n')
+			i++;
+		
+		if(line[i] == '\0' || line[i] == '#')
+			break;
+		
+		if(list->count + 1 >= list->size) {
+			// Token list is full, so make it bigger
+			list->size = (list->size == 0) ? 32 : list->size * 2;
+			list->views = realloc(list->views, list->size * sizeof(token_t));
+			list->words = realloc(list->words, list->size * sizeof(char *));
+		}
+		
+		token = &list->views[list->count++];
+		token->offset = i;
+		token->escaped = false;
+		
+		if((token->operator = operator_match(line + i)) != NULL) {
+			token->length = strlen(token->operator);
+			i += token->length;
+			continue;
+		}
+		
+		// Operators starting with a descriptor number (e.g. 2>) only count at 
+		// the start of a word
+		while(line[i] != '\0' && line[i] != ' ' && line[i] != '\t' && 
+			line[i] != '\n' && (line[i] == '2' || operator_match(line + i) == NULL)) {
+			char quote = line[i];
+			
+			if(quote == '\\') {
+				// Backslash, the next character is taken literally
+				token->escaped = true;
+				i += (line[i + 1] == '\0') ? 1 : 2;
+			}
+			else if(quote == '\'' || quote == '"') {
+				// Quoted section, find the matching quote
+				token->escaped = true;
+				i++;
+				
+				while(line[i] != quote) {
+					if(line[i] == '\0') {
+						if(!lexer_quiet)
+							fprintf(stderr, "error: unterminated %c quote\n", quote);
+						
+						return false;
+					}
+					
+					if(quote == '"' && line[i] == '\\' && line[i + 1] != '\0')
+						i++;
+					
+					i++;
+				}
+				
+				i++;
+			}
+			else
+				i++;
+		}
+		
+		token->length = i - token->offset;
+	}
+	
+	return true;
+}
+
+/* Get the character that stands for a quoted character, so it isn't expanded
+   
+   Params:
+   	c - The quoted character
+   
+   Returns:
+   	The matching one of QUOTED_CHARACTERS if c is one of EXPANDED_CHARACTERS,
+   	otherwise c itself.
+ */
+char quote_character(char c) {
+	const char *expanded = (c == '\0') ? NULL : strchr(EXPANDED_CHARACTERS, c);
+	
+	return (expanded == NULL) ? c : QUOTED_CHARACTERS[expanded - EXPANDED_CHARACTERS];
+}
+
+/* Get the character a quoted character stands for (see quote_character())
+   
+   Params:
+   	c - The character
+   
+   Returns:
+   	The matching one of EXPANDED_CHARACTERS if c is one of 
+   	QUOTED_CHARACTERS, otherwise c itself.
+ */
+char unquote_character(char c) {
+	// The quoted characters are consecutive, so this is a range check
+	if(c < QUOTED_DOLLAR || c >= QUOTED_DOLLAR + (char)strlen(QUOTED_CHARACTERS))
+		return c;
+	
+	return EXPANDED_CHARACTERS[c - QUOTED_DOLLAR];
+}
+
+/* Put back the quoted characters in a word that has been expanded, in place
+   
+   Params:
+   	word - The word
+ */
+void unquote_word(char *word) {
+	for(char *c = word; *c != '\0'; c++)
+		*c = unquote_character(*c);
+	
+	return;
+}
+
+/* Remove the quotes and backslashes from a word, in place. Quoted characters
+   that would otherwise be expanded are replaced (see quote_character()).
+   
+   Params:
+   	word - The start of the word
+   	length - The length of the word
+   	
+   Returns:
+   	The new length of the word, which is never longer than before.
+ */
+size_t unescape_word(char *word, size_t length) {
+	size_t in = 0;
+	size_t out = 0;
+	char quote = '\0';
+	
+	while(in < length) {
+		char c = word[in++];
+		
+		if(quote == '\'') {
+			// Everything within single quotes is literal
+			if(c == '\'')
+				quote = '\0';
+			else
+				word[out++] = quote_character(c);
+		}
+		else if(quote == '"') {
+			// Within double quotes a backslash only escapes a few characters
+			if(c == '"')
+				quote = '\0';
+			else if(c == '\\' && in < length && strchr("$`\"\\", word[in]) != NULL) {
+				c = word[in++];
+				word[out++] = quote_character(c);
+			}
+			else
+				// Only variables are expanded within double quotes, and what
+				// they expand to is quoted
+				word[out++] = (c == '$') ? QUOTED_EXPANSION : quote_character(c);
+		}
+		else if(c == '\'' || c == '"')
+			quote = c;
+		else if(c == '\\' && in < length) {
+			c = word[in++];
+			word[out++] = quote_character(c);
+		}
+		else
+			word[out++] = c;
+	}
+	
+	return out;
+}
+
+/* Turn a line's tokens into strings
+   
+   Words are terminated and unescaped in place within the line, so the line 
+   must not be used as a whole afterwards. Operators are represented by their
+   token strings (e.g. token_pipe), which is_operator() recognises.
+   
+   Params:
+   	line - The line the tokens were taken from
+   	list - The tokens from lex_line()
+   	
+   Returns:
+   	The token strings, terminated by NULL.
+ */
+char **token_strings(char *line, token_list_t *list) {
+	for(int i = 0; i < list->count; i++) {
+		token_t *token = &list->views[i];
+		
+		if(token->operator != NULL) {
+			list->words[i] = token->operator;
+			continue;
+		}
+		
+		if(token->escaped)
+			token->length = unescape_word(line + token->offset, token->length);
+		
+		// Anything following a word is a blank or an operator, which has
+		// already been recorded, so it can be overwritten
+		line[token->offset + token->length] = '\0';
+		list->words[i] = line + token->offset;
+	}
+	
+	list->words[list->count] = NULL;
+	
+	return list->words;
+}
+
+/* Split a line into token strings in place (see lex_line() and token_strings())
+   
+   Params:
+   	line - The line to split, it is modified
+   	list - The token list to fill in
+   	
+   Returns:
+   	The number of tokens, or -1 if the line couldn't be split.
+ */
+int tokenize(char *line, token_list_t *list) {
+	if(!lex_line(line, list))
+		return -1;
+	
+	if(list->size == 0) {
+		// Always have room for the terminating NULL
+		list->size = 1;
+		list->words = malloc(sizeof(char *));
+	}
+	
+	token_strings(line, list);
+	
+	return list->count;
+}
+
+/* Release a token list's memory
+   
+   Params:
+   	list - The token list to release
+ */
+void token_list_free(token_list_t *list) {
+	free(list->views);
+	free(list->words);
+	list->views = NULL;
+	list->words = NULL;
+	list->count = 0;
+	list->size = 0;
+	
+	return;
+}
+
+/* Join words into a single string, separated by spaces
+   
+   Params:
+   	count - The number of words
+   	words - The words to join
+   	
+   Returns:
+   	A newly allocated string holding the words.
+ */
+char *join_words(int count, char *words[]) {
+	size_t length = 1;
+	char *joined;
+	
+	for(int i = 0; i < count; i++)
+		length += strlen(words[i]) + 1;
+	
+	joined = malloc(length);
+	joined[0] = '\0';
+	
+	for(int i = 0; i < count; i++) {
+		if(i > 0)
+			strcat(joined, " ");
+		
+		strcat(joined, words[i]);
+	}
+	
+	return joined;
+}
+
+/* Add a token string to the end of a token vector
+   
+   Params:
+   	vector - The vector to add to
+   	token - The token string
+ */
+void token_vector_add(token_vector_t *vector, char *token) {
+	if(vector->count == vector->size) {
+		vector->size = (vector->size == 0) ? 16 : vector->size * 2;
+		vector->tokens = realloc(vector->tokens, vector->size * sizeof(char *));
+	}
+	
+	vector->tokens[vector->count++] = token;
+	
+	return;
+}
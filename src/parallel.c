@@ -0,0 +1,397 @@
+/*
+ * parallel.c
+ *
+ * CS210 Semester 2 Shell Project
+ *
+ * The parallel command: runs a batch of commands, a limited number at a time.
+ *
+ * Authors:
+ *	Mark Anderson <mark.anderson@strath.ac.uk>
+ *	Andrew Logan <andrew.logan@strath.ac.uk>
+ *	John Meikle <john.meikle@strath.ac.uk>
+ *
+ * Version:
+ *	0.9-stage9
+ *
+ */
+
+#include "shell.h"
+
+/* Add data to a buffer, making it bigger if need be
+   
+   Params:
+   	buffer - The buffer
+   	data - The data to add
+   	length - The length of the data
+ */
+void buffer_append(buffer_t *buffer, const char *data, size_t length) {
+	if(buffer->length + length > buffer->size) {
+		while(buffer->length + length > buffer->size)
+			buffer->size = (buffer->size == 0) ? 4096 : buffer->size * 2;
+		
+		buffer->data = realloc(buffer->data, buffer->size);
+	}
+	
+	memcpy(buffer->data + buffer->length, data, length);
+	buffer->length += length;
+	
+	return;
+}
+
+/* Run a command line in a parallel job's child shell, never returning
+   
+   A plain external command is executed in place of the child shell, so it
+   costs no more processes than running it from the prompt. Anything else
+   (builtins, pipelines and lists) is run by the child shell.
+   
+   Params:
+   	command - The command line, it is modified
+ */
+void parallel_exec(char *command) {
+	token_list_t tokens = { NULL, NULL, 0, 0 };
+	char **words;
+	int *depths;
+	int count = tokenize(command, &tokens);
+	bool plain;
+	
+	if(count < 0)
+		_exit(2);
+	
+	count = alias_expand(count, tokens.words, &words, &depths);
+	plain = (count > 0 && builtin_find(words[0]) == NULL);
+	
+	for(int i = 0; i < count && plain; i++) {
+		if(is_operator(words[i]) || is_expandable(words[i]) || is_assignment(words[i]))
+			plain = false;
+	}
+	
+	if(plain) {
+		const char *path = path_lookup(words[0]);
+		
+		if(path == NULL) {
+			fprintf(stderr, "%s: command not found\n", words[0]);
+			_exit(127);
+		}
+		
+		execve(path, words, var_environment());
+		
+		perror(words[0]);
+		_exit(errno == ENOENT ? 127 : 126);
+	}
+	
+	run_list(count, words, depths);
+	fflush(stdout);
+	_exit(exit_status);
+}
+
+/* Start a parallel job
+   
+   Params:
+   	job - The job, with its command set
+   
+   Returns:
+   	Whether it could be started. If it couldn't, the job is finished with
+   	status 127 and no output.
+ */
+bool parallel_start(parallel_job_t *job) {
+	int out[2], err[2];
+	stage_setup_t setup;
+	
+	job->reaped = false;
+	job->status = 0;
+	job->out = job->err = -1;
+	job->output.length = job->errors.length = 0;
+	
+	if(pipe2(out, O_CLOEXEC) == -1) {
+		perror("parallel: pipe() failed");
+		job->reaped = true;
+		job->status = 127 << 8;
+		return false;
+	}
+	
+	if(pipe2(err, O_CLOEXEC) == -1) {
+		perror("parallel: pipe() failed");
+		close(out[0]);
+		close(out[1]);
+		job->reaped = true;
+		job->status = 127 << 8;
+		return false;
+	}
+	
+	// The jobs get no input, and share the shell's process group
+	setup.in = open("/dev/null", O_RDONLY | O_CLOEXEC);
+	setup.out = out[1];
+	setup.pgid = -1;
+	setup.foreground = false;
+	setup.redirect_count = 0;
+	
+	fflush(stdout);
+	job->pid = fork();
+	
+	if(job->pid == 0) {
+		subshell = true;
+		job_control = false;
+		child_wakeup = -1;
+		stage_setup_child(&setup);
+		dup2(err[1], STDERR_FILENO);
+		parallel_exec(job->command);
+	}
+	
+	close(setup.in);
+	close(out[1]);
+	close(err[1]);
+	
+	if(job->pid < 0) {
+		perror("parallel: fork() failed");
+		close(out[0]);
+		close(err[0]);
+		job->reaped = true;
+		job->status = 127 << 8;
+		return false;
+	}
+	
+	job->out = out[0];
+	job->err = err[0];
+	
+	return true;
+}
+
+/* Read what's waiting on one of a parallel job's output pipes
+   
+   Params:
+   	fd - The pipe, which is closed and set to -1 at end of file
+   	buffer - The buffer to add the output to
+ */
+void parallel_read(int *fd, buffer_t *buffer) {
+	char data[INPUT_CHUNK];
+	ssize_t length = read(*fd, data, sizeof(data));
+	
+	if(length > 0)
+		buffer_append(buffer, data, length);
+	else if(length == 0 || errno != EINTR) {
+		close(*fd);
+		*fd = -1;
+	}
+	
+	return;
+}
+
+/* Output a finished parallel job's output, all at once so it isn't mixed up
+   with any other job's, and report it if it failed
+   
+   Params:
+   	job - The job
+   
+   Returns:
+   	The job's exit status.
+ */
+int parallel_finish(parallel_job_t *job) {
+	int status = WIFSIGNALED(job->status) ? 128 + WTERMSIG(job->status) :
+		WEXITSTATUS(job->status);
+	
+	fwrite(job->output.data, 1, job->output.length, stdout);
+	fflush(stdout);
+	fwrite(job->errors.data, 1, job->errors.length, stderr);
+	
+	if(status != 0)
+		fprintf(stderr, "parallel: '%s' failed with status %d\n", job->command,
+			status);
+	
+	free(job->command);
+	job->command = NULL;
+	
+	return status;
+}
+
+/* Get the next command for the parallel command to run
+   
+   Params:
+   	count - The number of commands given as arguments
+   	commands - The commands given as arguments
+   	next - The number of commands taken so far
+   	input - Where to read commands from if there are no arguments, or NULL 
+   		for none
+   
+   Returns:
+   	A copy of the command, which must be freed, or NULL if there are no more.
+ */
+char *parallel_next(int count, char *commands[], int next, input_t *input) {
+	const char *line;
+	size_t length;
+	char *command;
+	
+	if(count > 0) {
+		if(next >= count)
+			return NULL;
+		
+		command = malloc(strlen(commands[next]) + 1);
+		
+		return strcpy(command, commands[next]);
+	}
+	
+	// Read lines, skipping blank ones
+	do {
+		if(input == NULL || (line = input_getline(input, &length)) == NULL)
+			return NULL;
+		
+		while(length > 0 && (line[0] == ' ' || line[0] == '\t')) {
+			line++;
+			length--;
+		}
+	} while(length == 0);
+	
+	command = malloc(length + 1);
+	memcpy(command, line, length);
+	command[length] = '\0';
+	
+	return command;
+}
+
+/* parallel internal command
+   
+   Runs each command in a child shell, keeping up to limit of them running at
+   once. The shell sleeps in poll() on the jobs' output pipes and on a pipe the
+   SIGCHLD handler writes to (see child_wakeup), so new jobs start as soon as
+   slots free up. Each job's output is collected and only written once the
+   job is done, so the output of different jobs isn't interleaved.
+   
+   Params:
+   	limit - The most jobs to run at once
+   	count - The number of commands given as arguments
+   	commands - The commands, if there are none they are read from input
+   	input - Where to read commands from, one per line, or NULL for none
+   
+   Returns:
+   	0 if every job succeeded, otherwise the number of failed jobs (at most
+   	101), or 1 if no jobs could be run.
+ */
+int command_parallel(int limit, int count, char *commands[], input_t *input) {
+	parallel_job_t *slots = calloc(limit, sizeof(parallel_job_t));
+	struct pollfd *fds = malloc((limit * 2 + 1) * sizeof(struct pollfd));
+	int *fd_slots = malloc((limit * 2 + 1) * sizeof(int));
+	int wakeup[2];
+	int running = 0, taken = 0, failed = 0, total = 0;
+	bool more = true, changed = true;
+	
+	if(pipe2(wakeup, O_CLOEXEC | O_NONBLOCK) == -1) {
+		// Without it the jobs couldn't be waited for, so none are run
+		perror("parallel: pipe() failed");
+		free(slots);
+		free(fds);
+		free(fd_slots);
+		return 1;
+	}
+	
+	child_wakeup = wakeup[1];
+	
+	// The child shells would otherwise each load the aliases
+	alias_ready();
+	
+	while(more || running > 0) {
+		int fd_count = 1;
+		
+		// Fill any free slots
+		for(int i = 0; i < limit && more; i++) {
+			if(slots[i].command != NULL)
+				continue;
+			
+			if((slots[i].command = parallel_next(count, commands, taken++, input)) == NULL) {
+				more = false;
+				break;
+			}
+			
+			running++;
+			parallel_start(&slots[i]);
+		}
+		
+		// Collect the jobs that are done, which is once the child has exited 
+		// and everything it started has finished with its output pipes
+		for(int i = 0; i < limit; i++) {
+			parallel_job_t *job = &slots[i];
+			
+			if(job->command == NULL)
+				continue;
+			
+			if(!job->reaped && (changed || (job->out == -1 && job->err == -1)) &&
+				waitpid(job->pid, &job->status, WNOHANG) == job->pid)
+				job->reaped = true;
+			
+			if(job->reaped && job->out == -1 && job->err == -1) {
+				failed += (parallel_finish(job) != 0);
+				total++;
+				running--;
+			}
+		}
+		
+		changed = false;
+		
+		if(running == 0)
+			continue;
+		
+		// Wait for output, or for a child to change state
+		fds[0].fd = wakeup[0];
+		fds[0].events = POLLIN;
+		
+		for(int i = 0; i < limit; i++) {
+			if(slots[i].command != NULL && slots[i].out != -1) {
+				fd_slots[fd_count] = i;
+				fds[fd_count].fd = slots[i].out;
+				fds[fd_count++].events = POLLIN;
+			}
+			
+			if(slots[i].command != NULL && slots[i].err != -1) {
+				fd_slots[fd_count] = i;
+				fds[fd_count].fd = slots[i].err;
+				fds[fd_count++].events = POLLIN;
+			}
+		}
+		
+		if(poll(fds, fd_count, -1) == -1) {
+			if(errno != EINTR) {
+				perror("parallel: poll() failed");
+				break;
+			}
+			
+			continue;
+		}
+		
+		if(fds[0].revents != 0) {
+			char drain[64];
+			
+			while(read(wakeup[0], drain, sizeof(drain)) > 0)
+				;
+			
+			changed = true;
+		}
+		
+		for(int i = 1; i < fd_count; i++) {
+			parallel_job_t *job = &slots[fd_slots[i]];
+			
+			if(fds[i].revents == 0)
+				continue;
+			
+			if(fds[i].fd == job->out)
+				parallel_read(&job->out, &job->output);
+			else
+				parallel_read(&job->err, &job->errors);
+		}
+	}
+	
+	child_wakeup = -1;
+	close(wakeup[0]);
+	close(wakeup[1]);
+	
+	for(int i = 0; i < limit; i++) {
+		free(slots[i].output.data);
+		free(slots[i].errors.data);
+	}
+	
+	free(slots);
+	free(fds);
+	free(fd_slots);
+	
+	if(failed > 0)
+		fprintf(stderr, "parallel: %d of %d jobs failed\n", failed, total);
+	
+	return (failed > 101) ? 101 : failed;
+}
@@ -0,0 +1,242 @@
+/*
+ * path.c
+ *
+ * CS210 Semester 2 Shell Project
+ *
+ * Locating commands in PATH, and the cache of their locations.
+ *
+ * Authors:
+ *	Mark Anderson <mark.anderson@strath.ac.uk>
+ *	Andrew Logan <andrew.logan@strath.ac.uk>
+ *	John Meikle <john.meikle@strath.ac.uk>
+ *
+ * Version:
+ *	0.9-stage9
+ *
+ */
+
+#include "shell.h"
+
+// Stores the cached command locations, chained by hash
+path_entry_t *path_cache[PATH_CACHE_SIZE];
+
+// Stores the number of cache lookups that did and didn't need a PATH search
+unsigned long path_cache_hits = 0;
+unsigned long path_cache_misses = 0;
+
+/* Hash a string (FNV-1a)
+   
+   Params:
+   	key - The string to hash
+   	
+   Returns:
+   	The hash value of the string.
+ */
+unsigned int hash_string(const char *key) {
+	unsigned int hash = 2166136261u;
+	
+	while(*key != '\0') {
+		hash ^= (unsigned char)*key++;
+		hash *= 16777619u;
+	}
+	
+	return hash;
+}
+
+/* Form the location of one of the shell's files in the HOME directory
+   
+   Params:
+   	name - The file name (e.g. .aliases)
+   	
+   Returns:
+   	A newly allocated string holding the location of the file.
+ */
+char *home_file(const char *name) {
+	const char *home = (env_home == NULL) ? "." : env_home;
+	char *path = malloc(strlen(home) + strlen(name) + 2);
+	
+	strcpy(path, home);
+	strcat(path, "/");
+	strcat(path, name);
+	
+	return path;
+}
+
+/* Search each directory of the current PATH for an executable file
+   
+   Params:
+   	name - The command name (e.g. ls)
+   	
+   Returns:
+   	A newly allocated string holding the location of the command (e.g. 
+   	/bin/ls). If no executable is found, NULL is returned.
+ */
+char *path_search(const char *name) {
+	const char *dir = env_path_current;
+	size_t name_length = strlen(name);
+	
+	if(dir == NULL)
+		return NULL;
+	
+	while(1) {
+		// Find the end of this PATH element, an empty element means "."
+		const char *end = strchr(dir, ':');
+		size_t dir_length = (end == NULL) ? strlen(dir) : (size_t)(end - dir);
+		char *candidate = malloc(dir_length + name_length + 3);
+		struct stat info;
+		
+		if(dir_length == 0)
+			strcpy(candidate, ".");
+		else {
+			memcpy(candidate, dir, dir_length);
+			candidate[dir_length] = '\0';
+		}
+		
+		strcat(candidate, "/");
+		strcat(candidate, name);
+		
+		if(stat(candidate, &info) == 0 && S_ISREG(info.st_mode) &&
+			access(candidate, X_OK) == 0)
+			// Found an executable file
+			return candidate;
+		
+		free(candidate);
+		
+		if(end == NULL)
+			break;
+		
+		dir = end + 1;
+	}
+	
+	return NULL;
+}
+
+/* Add a resolved command location to the PATH cache
+   
+   Params:
+   	name - The command name (e.g. ls)
+   	path - The location of the command, the cache takes ownership of it
+   	
+   Returns:
+   	The cache entry for the command.
+ */
+path_entry_t *path_cache_add(const char *name, char *path) {
+	unsigned int bucket = hash_string(name) % PATH_CACHE_SIZE;
+	path_entry_t *entry = malloc(sizeof(path_entry_t));
+	
+	entry->name = malloc(strlen(name) + 1);
+	strcpy(entry->name, name);
+	entry->path = path;
+	entry->hits = 0;
+	entry->next = path_cache[bucket];
+	path_cache[bucket] = entry;
+	
+	return entry;
+}
+
+/* Find the cache entry for a command name
+   
+   Params:
+   	name - The command name (e.g. ls)
+   	
+   Returns:
+   	The cache entry for the command, or NULL if it isn't cached.
+ */
+path_entry_t *path_cache_find(const char *name) {
+	path_entry_t *entry = path_cache[hash_string(name) % PATH_CACHE_SIZE];
+	
+	while(entry != NULL && strcmp(entry->name, name) != 0)
+		entry = entry->next;
+	
+	return entry;
+}
+
+/* Remove a command from the PATH cache
+   
+   Params:
+   	name - The command name (e.g. ls)
+ */
+void path_cache_remove(const char *name) {
+	path_entry_t **link = &path_cache[hash_string(name) % PATH_CACHE_SIZE];
+	
+	while(*link != NULL) {
+		path_entry_t *entry = *link;
+		
+		if(strcmp(entry->name, name) == 0) {
+			*link = entry->next;
+			free(entry->name);
+			free(entry->path);
+			free(entry);
+			return;
+		}
+		
+		link = &entry->next;
+	}
+	
+	return;
+}
+
+/* Empty the PATH cache, must be called whenever PATH changes */
+void path_cache_clear() {
+	for(int i = 0; i < PATH_CACHE_SIZE; i++) {
+		path_entry_t *entry = path_cache[i];
+		
+		while(entry != NULL) {
+			path_entry_t *next = entry->next;
+			
+			free(entry->name);
+			free(entry->path);
+			free(entry);
+			entry = next;
+		}
+		
+		path_cache[i] = NULL;
+	}
+	
+	return;
+}
+
+/* Resolve a command name to the location of the program to execute
+   
+   Names containing a '/' are used as they are, anything else is looked up in
+   the PATH cache and only searched for in PATH on a miss. Locations found via
+   a relative PATH element depend on the working directory, so they aren't
+   cached.
+   
+   Params:
+   	name - The command name (e.g. ls)
+   	
+   Returns:
+   	The location of the program, valid until the next call. If the command 
+   	can't be found, NULL is returned.
+ */
+const char *path_lookup(const char *name) {
+	static char *uncached = NULL;
+	path_entry_t *entry;
+	char *path;
+	
+	if(strchr(name, '/') != NULL)
+		return name;
+	
+	if((entry = path_cache_find(name)) != NULL) {
+		path_cache_hits++;
+		entry->hits++;
+		return entry->path;
+	}
+	
+	path_cache_misses++;
+	
+	if((path = path_search(name)) == NULL)
+		return NULL;
+	
+	if(path[0] != '/') {
+		free(uncached);
+		uncached = path;
+		return path;
+	}
+	
+	entry = path_cache_add(name, path);
+	entry->hits++;
+	
+	return entry->path;
+}
@@ -0,0 +1,171 @@
+/*
+ * redirect.c
+ *
+ * CS210 Semester 2 Shell Project
+ *
+ * Input and output redirection (<, >, >>, 2> and 2>&1).
+ *
+ * Authors:
+ *	Mark Anderson <mark.anderson@strath.ac.uk>
+ *	Andrew Logan <andrew.logan@strath.ac.uk>
+ *	John Meikle <john.meikle@strath.ac.uk>
+ *
+ * Version:
+ *	0.9-stage9
+ *
+ */
+
+#include "shell.h"
+
+/* Check whether a token string is a redirection operator
+   
+   Params:
+   	token - The token string
+   
+   Returns:
+   	If the token is a redirection operator, true is returned. Otherwise false.
+ */
+bool is_redirect(const char *token) {
+	return token == token_input || token == token_output || token == token_append ||
+		token == token_error || token == token_error_output;
+}
+
+/* Get the descriptor a redirection replaces
+   
+   Params:
+   	redirect - The redirection
+   
+   Returns:
+   	The descriptor, e.g. STDOUT_FILENO for >.
+ */
+int redirect_target(const redirect_t *redirect) {
+	if(redirect->operator == token_input)
+		return STDIN_FILENO;
+	
+	if(redirect->operator == token_error || redirect->operator == token_error_output)
+		return STDERR_FILENO;
+	
+	return STDOUT_FILENO;
+}
+
+/* Open the files of a command's redirections
+   
+   The files are opened by the shell, close-on-exec, and the started process
+   only has to dup2() them into place. That way a file that can't be opened is
+   reported as such, and the command isn't started.
+   
+   Params:
+   	count - The number of redirections
+   	redirects - The redirections, in order
+   	fds - Filled in with the descriptor to dup2() onto each redirection's
+   		target (for 2>&1 that's STDOUT_FILENO, which isn't opened)
+   
+   Returns:
+   	Whether every file could be opened. If not, none are left open.
+ */
+bool redirects_open(int count, const redirect_t redirects[], int fds[]) {
+	for(int i = 0; i < count; i++) {
+		const redirect_t *redirect = &redirects[i];
+		int flags = O_WRONLY | O_CREAT | O_CLOEXEC;
+		
+		if(redirect->target == NULL) {
+			fds[i] = STDOUT_FILENO;
+			continue;
+		}
+		
+		if(redirect->operator == token_input)
+			flags = O_RDONLY | O_CLOEXEC;
+		else if(redirect->operator == token_append)
+			flags |= O_APPEND;
+		else
+			flags |= O_TRUNC;
+		
+		if((fds[i] = open(redirect->target, flags, 0666)) == -1) {
+			fprintf(stderr, "%s: %s\n", redirect->target, strerror(errno));
+			redirects_close(i, redirects, fds);
+			return false;
+		}
+	}
+	
+	return true;
+}
+
+/* Close the files opened by redirects_open()
+   
+   Params:
+   	count - The number of redirections
+   	redirects - The redirections
+   	fds - The descriptors from redirects_open()
+ */
+void redirects_close(int count, const redirect_t redirects[], int fds[]) {
+	for(int i = 0; i < count; i++) {
+		if(redirects[i].target != NULL)
+			close(fds[i]);
+	}
+	
+	return;
+}
+
+/* Redirect the shell's own standard descriptors for a builtin, which runs
+   without forking
+   
+   Params:
+   	count - The number of redirections
+   	redirects - The redirections, in order
+   	saved - Filled in with close-on-exec copies of the standard input, output
+   		and error, or -1 for those that aren't redirected, which
+   		redirects_restore() puts back
+   
+   Returns:
+   	Whether the redirections could be made. If not, nothing is changed.
+ */
+bool redirects_swap(int count, const redirect_t redirects[], int saved[3]) {
+	int fds[count];
+	
+	saved[0] = saved[1] = saved[2] = -1;
+	
+	if(count == 0)
+		return true;
+	
+	if(!redirects_open(count, redirects, fds))
+		return false;
+	
+	// Anything the shell has buffered belongs to the old output
+	fflush(stdout);
+	fflush(stderr);
+	
+	for(int i = 0; i < count; i++) {
+		int target = redirect_target(&redirects[i]);
+		
+		if(saved[target] == -1)
+			saved[target] = fcntl(target, F_DUPFD_CLOEXEC, 10);
+		
+		dup2(fds[i], target);
+	}
+	
+	redirects_close(count, redirects, fds);
+	
+	return true;
+}
+
+/* Put back the standard descriptors replaced by redirects_swap()
+   
+   Params:
+   	saved - The copies filled in by redirects_swap()
+ */
+void redirects_restore(int saved[3]) {
+	if(saved[0] == -1 && saved[1] == -1 && saved[2] == -1)
+		return;
+	
+	fflush(stdout);
+	fflush(stderr);
+	
+	for(int i = 0; i < 3; i++) {
+		if(saved[i] != -1) {
+			dup2(saved[i], i);
+			close(saved[i]);
+		}
+	}
+	
+	return;
+}
@@ -0,0 +1,434 @@
+/*
+ * script.c
+ *
+ * CS210 Semester 2 Shell Project
+ *
+ * The script cache: script files are parsed once into a compact form, which
+ * later runs load from a cache file instead of parsing the script again.
+ *
+ * Authors:
+ *	Mark Anderson <mark.anderson@strath.ac.uk>
+ *	Andrew Logan <andrew.logan@strath.ac.uk>
+ *	John Meikle <john.meikle@strath.ac.uk>
+ *
+ * Version:
+ *	0.9-stage9
+ *
+ */
+
+#include "shell.h"
+
+/* Get the location of a script's cache file
+   
+   The cache files are kept in the directory named by SHELL_SCRIPT_CACHE, or
+   .script_cache in HOME if it isn't set, and caching is off if it's "off".
+   Each is named by a hash of the script's full path, which the file also
+   holds, so scripts whose hashes are the same just replace each other's file.
+   
+   Params:
+   	path - The script
+   
+   Returns:
+   	A newly allocated string holding the location, or NULL if scripts aren't
+   	cached.
+ */
+char *script_cache_file(const char *path) {
+	const char *dir = var_get("SHELL_SCRIPT_CACHE");
+	char *full_path = realpath(path, NULL);
+	char *default_dir = NULL;
+	char *file;
+	
+	if(full_path == NULL || (dir != NULL && strcmp(dir, "off") == 0) ||
+		(dir == NULL && env_home == NULL)) {
+		free(full_path);
+		return NULL;
+	}
+	
+	if(dir == NULL)
+		dir = default_dir = home_file(".script_cache");
+	
+	file = malloc(strlen(dir) + 16);
+	sprintf(file, "%s/%08x", dir, hash_string(full_path));
+	free(full_path);
+	free(default_dir);
+	
+	return file;
+}
+
+/* Fill in the header of a script's parsed form
+   
+   Params:
+   	header - The header to fill in
+   	path - The script
+   	info - The script's details, from stat()
+ */
+void script_header(script_header_t *header, const char *path, const struct stat *info) {
+	memset(header, 0, sizeof(*header));
+	memcpy(header->magic, SCRIPT_MAGIC, sizeof(header->magic));
+	header->format = SCRIPT_FORMAT;
+	strncpy(header->version, SHELL_VERSION, sizeof(header->version) - 1);
+	header->size = info->st_size;
+	header->modified = info->st_mtim.tv_sec;
+	header->modified_ns = info->st_mtim.tv_nsec;
+	header->path_length = strlen(path) + 1;
+	
+	return;
+}
+
+/* Parse a script into its compact form
+   
+   The form is a script_header_t, the script's full path and then each line
+   that has any tokens: the number of tokens (a uint32_t), then each token as
+   a type byte, 0 for a word, which is followed by the word, or an operator's
+   index in operators plus 1 (the same as in the alias arena). A line that
+   can't be split is kept as it is, with SCRIPT_RAW as its count, so its error
+   is reported when it's run. The form ends with a '\0'.
+   
+   Params:
+   	path - The script
+   	info - The script's details, from stat()
+   	image - The buffer to put the parsed form in
+   
+   Returns:
+   	Whether the script could be read.
+ */
+bool script_compile(const char *path, const struct stat *info, buffer_t *image) {
+	token_list_t tokens = { NULL, NULL, 0, 0 };
+	char *full_path = realpath(path, NULL);
+	script_header_t header;
+	input_t input;
+	char *line = NULL;
+	size_t line_size = 0;
+	const char *text;
+	size_t length;
+	
+	if(full_path == NULL || !input_open_file(&input, path)) {
+		free(full_path);
+		return false;
+	}
+	
+	script_header(&header, full_path, info);
+	buffer_append(image, (char *)&header, sizeof(header));
+	buffer_append(image, full_path, header.path_length);
+	free(full_path);
+	lexer_quiet = true;
+	
+	while((text = input_getline(&input, &length)) != NULL) {
+		uint32_t count;
+		int token_count;
+		
+		if(length + 1 > line_size) {
+			line_size = length + 1;
+			line = realloc(line, line_size);
+		}
+		
+		memcpy(line, text, length);
+		line[length] = '\0';
+		
+		if((token_count = tokenize(line, &tokens)) < 0) {
+			// Keep the line itself, it was only split up to the error
+			count = SCRIPT_RAW;
+			buffer_append(image, (char *)&count, sizeof(count));
+			buffer_append(image, text, length);
+			buffer_append(image, "", 1);
+			header.line_count++;
+			continue;
+		}
+		
+		if(token_count == 0)
+			continue;
+		
+		count = token_count;
+		buffer_append(image, (char *)&count, sizeof(count));
+		
+		for(int i = 0; i < token_count; i++) {
+			char type = 0;
+			
+			for(int j = 0; operators[j] != NULL; j++) {
+				if(tokens.words[i] == operators[j])
+					type = j + 1;
+			}
+			
+			buffer_append(image, &type, 1);
+			
+			if(type == 0)
+				buffer_append(image, tokens.words[i], strlen(tokens.words[i]) + 1);
+		}
+		
+		header.line_count++;
+	}
+	
+	lexer_quiet = false;
+	
+	// A '\0' at the very end means reading a word can't run past the end
+	buffer_append(image, "", 1);
+	header.length = image->length - sizeof(header) - header.path_length;
+	memcpy(image->data, &header, sizeof(header));
+	
+	free(line);
+	token_list_free(&tokens);
+	input_close(&input);
+	
+	return true;
+}
+
+/* Write a script's parsed form to its cache file, by way of a temporary file
+   so a run reading the cache at the same time never sees half of it
+   
+   Params:
+   	file - The cache file, it is changed but put back
+   	image - The parsed form
+ */
+void script_cache_save(char *file, const buffer_t *image) {
+	char *temporary = malloc(strlen(file) + 32);
+	char *slash = strrchr(file, '/');
+	int fd;
+	
+	// Make the cache directory, if it's not there yet
+	*slash = '\0';
+	mkdir(file, 0700);
+	*slash = '/';
+	
+	sprintf(temporary, "%s.%d", file, (int)getpid());
+	
+	if((fd = open(temporary, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600)) == -1) {
+		free(temporary);
+		return;
+	}
+	
+	if(write(fd, image->data, image->length) == (ssize_t)image->length)
+		rename(temporary, file);
+	else
+		unlink(temporary);
+	
+	close(fd);
+	free(temporary);
+	
+	return;
+}
+
+/* Check that the lines of a parsed form are whole, so running it can't read
+   past its end or outside operators
+   
+   Params:
+   	position - The start of the lines
+   	end - The end of the parsed form
+   	line_count - The number of lines
+   
+   Returns:
+   	Whether every line is whole and every type byte is a word or an operator.
+ */
+bool script_check(const char *position, const char *end, uint32_t line_count) {
+	int operator_count = 0;
+	
+	while(operators[operator_count] != NULL)
+		operator_count++;
+	
+	for(uint32_t line = 0; line < line_count; line++) {
+		uint32_t count;
+		const char *word_end;
+		
+		if((size_t)(end - position) < sizeof(count))
+			return false;
+		
+		memcpy(&count, position, sizeof(count));
+		position += sizeof(count);
+		
+		if(count == SCRIPT_RAW) {
+			// The line itself, with no type byte
+			if((word_end = memchr(position, '\0', end - position)) == NULL)
+				return false;
+			
+			position = word_end + 1;
+			continue;
+		}
+		
+		for(uint32_t i = 0; i < count; i++) {
+			unsigned char type;
+			
+			if(position >= end || (type = *position++) > operator_count)
+				return false;
+			
+			if(type != 0)
+				continue;
+			
+			if((word_end = memchr(position, '\0', end - position)) == NULL)
+				return false;
+			
+			position = word_end + 1;
+		}
+	}
+	
+	return true;
+}
+
+/* Load a script's parsed form from its cache file, if it's there, was made
+   from the script as it is now by this version of the shell, is whole and is
+   only writable by this user
+   
+   Params:
+   	file - The cache file
+   	path - The script
+   	info - The script's details, from stat()
+   	length - Set to the length of the parsed form
+   
+   Returns:
+   	The parsed form, mapped privately so it can be changed, or NULL if it
+   	couldn't be used.
+ */
+char *script_cache_load(const char *file, const char *path, const struct stat *info,
+	size_t *length) {
+	char *full_path = realpath(path, NULL);
+	script_header_t expected;
+	const script_header_t *header;
+	struct stat file_info;
+	char *image;
+	int fd;
+	
+	if(full_path == NULL)
+		return NULL;
+	
+	// The cache directory may be shared, so only a file that no one else could
+	// have written is trusted
+	if((fd = open(file, O_RDONLY | O_CLOEXEC | O_NOFOLLOW)) == -1 || 
+		fstat(fd, &file_info) == -1 || !S_ISREG(file_info.st_mode) ||
+		file_info.st_uid != getuid() || (file_info.st_mode & (S_IWGRP | S_IWOTH)) != 0 ||
+		(size_t)file_info.st_size < sizeof(script_header_t)) {
+		if(fd != -1)
+			close(fd);
+		
+		free(full_path);
+		return NULL;
+	}
+	
+	image = mmap(NULL, file_info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close(fd);
+	
+	if(image == MAP_FAILED) {
+		free(full_path);
+		return NULL;
+	}
+	
+	// Everything but the counts has to be as this script would give
+	header = (const script_header_t *)image;
+	script_header(&expected, full_path, info);
+	
+	if(memcmp(header, &expected, offsetof(script_header_t, line_count)) != 0 ||
+		sizeof(*header) + header->path_length + header->length != (size_t)file_info.st_size ||
+		strcmp(image + sizeof(*header), full_path) != 0 ||
+		image[file_info.st_size - 1] != '\0' ||
+		!script_check(image + sizeof(*header) + header->path_length, 
+			image + file_info.st_size, header->line_count)) {
+		munmap(image, file_info.st_size);
+		free(full_path);
+		return NULL;
+	}
+	
+	free(full_path);
+	*length = file_info.st_size;
+	
+	return image;
+}
+
+/* Run a script's parsed form, which has been checked (see script_check())
+   
+   Params:
+   	image - The parsed form, which may be changed
+   	length - Its length
+ */
+void script_execute(char *image, size_t length) {
+	const script_header_t *header = (const script_header_t *)image;
+	token_vector_t words = { NULL, 0, 0 };
+	char *position = image + sizeof(*header) + header->path_length;
+	char *end = image + length;
+	
+	for(uint32_t line = 0; line < header->line_count && position + sizeof(uint32_t) <= end; line++) {
+		uint32_t count;
+		
+		// Collect any background jobs that have finished, as run_input() does
+		jobs_notify();
+		memcpy(&count, position, sizeof(count));
+		position += sizeof(count);
+		
+		if(count == SCRIPT_RAW) {
+			// run_line() splits the line in place, so its length is taken first
+			size_t raw_length = strlen(position) + 1;
+			
+			run_line(position);
+			position += raw_length;
+			continue;
+		}
+		
+		words.count = 0;
+		
+		for(uint32_t i = 0; i < count && position < end; i++) {
+			unsigned char type = *position++;
+			
+			if(type != 0)
+				token_vector_add(&words, operators[type - 1]);
+			else {
+				token_vector_add(&words, position);
+				position += strlen(position) + 1;
+			}
+		}
+		
+		token_vector_add(&words, NULL);
+		parse_tokens(words.count - 1, words.tokens);
+		alias_release();
+	}
+	
+	free(words.tokens);
+	
+	return;
+}
+
+/* Run a script file, from its cached parsed form if it has one, or else by
+   parsing it and then caching the parsed form
+   
+   A script changed within SCRIPT_RACY seconds of being parsed could change
+   again without its modification time changing, so it isn't cached.
+   
+   Params:
+   	path - The script
+   
+   Returns:
+   	Whether the script was run. If not, it should be run line by line.
+ */
+bool script_run(const char *path) {
+	buffer_t image = { NULL, 0, 0 };
+	struct stat info;
+	struct timespec now;
+	char *file;
+	char *mapped;
+	size_t length;
+	
+	if(stat(path, &info) == -1 || !S_ISREG(info.st_mode))
+		return false;
+	
+	file = script_cache_file(path);
+	
+	if(file != NULL && (mapped = script_cache_load(file, path, &info, &length)) != NULL) {
+		free(file);
+		script_execute(mapped, length);
+		munmap(mapped, length);
+		return true;
+	}
+	
+	if(!script_compile(path, &info, &image)) {
+		free(image.data);
+		free(file);
+		return false;
+	}
+	
+	clock_gettime(CLOCK_REALTIME, &now);
+	
+	if(file != NULL && (now.tv_sec - info.st_mtim.tv_sec) +
+		(now.tv_nsec - info.st_mtim.tv_nsec) / 1e9 >= SCRIPT_RACY)
+		script_cache_save(file, &image);
+	
+	free(file);
+	script_execute(image.data, image.length);
+	free(image.data);
+	
+	return true;
+}
@@ -0,0 +1,454 @@
+/*
+ * server.c
+ *
+ * CS210 Semester 2 Shell Project
+ *
+ * Server mode: a shell that loads its state once and runs commands sent over
+ * a Unix socket in forked workers, and the client that sends them.
+ *
+ * Authors:
+ *	Mark Anderson <mark.anderson@strath.ac.uk>
+ *	Andrew Logan <andrew.logan@strath.ac.uk>
+ *	John Meikle <john.meikle@strath.ac.uk>
+ *
+ * Version:
+ *	0.9-stage9
+ *
+ */
+
+#include "shell.h"
+
+// Stores the connection a worker replies on, -1 if this isn't a worker
+int server_connection = -1;
+
+/* Fill in the address of a socket
+   
+   Params:
+   	address - The address to fill in
+   	path - The socket's location
+   
+   Returns:
+   	Whether the location fits in an address.
+ */
+bool server_address(struct sockaddr_un *address, const char *path) {
+	memset(address, 0, sizeof(*address));
+	address->sun_family = AF_UNIX;
+	
+	if(strlen(path) >= sizeof(address->sun_path)) {
+		fprintf(stderr, "%s: socket path too long\n", path);
+		return false;
+	}
+	
+	strcpy(address->sun_path, path);
+	
+	return true;
+}
+
+/* Read exactly a number of bytes, unless the other end closes first
+   
+   Params:
+   	fd - The descriptor to read from
+   	data - Where to put the bytes
+   	length - The number of bytes
+   
+   Returns:
+   	Whether all of them were read.
+ */
+bool server_read(int fd, void *data, size_t length) {
+	for(size_t done = 0; done < length; ) {
+		ssize_t result = read(fd, (char *)data + done, length - done);
+		
+		if(result == -1 && errno == EINTR)
+			continue;
+		
+		if(result <= 0)
+			return false;
+		
+		done += result;
+	}
+	
+	return true;
+}
+
+/* Write exactly a number of bytes
+   
+   Params:
+   	fd - The descriptor to write to
+   	data - The bytes
+   	length - The number of bytes
+   
+   Returns:
+   	Whether all of them were written.
+ */
+bool server_write(int fd, const void *data, size_t length) {
+	for(size_t done = 0; done < length; ) {
+		ssize_t result = write(fd, (const char *)data + done, length - done);
+		
+		if(result == -1 && errno == EINTR)
+			continue;
+		
+		if(result <= 0)
+			return false;
+		
+		done += result;
+	}
+	
+	return true;
+}
+
+/* Send a worker's exit status back to its client, once */
+void server_reply() {
+	int32_t status = exit_status;
+	
+	if(server_connection == -1)
+		return;
+	
+	fflush(stdout);
+	fflush(stderr);
+	server_write(server_connection, &status, sizeof(status));
+	close(server_connection);
+	server_connection = -1;
+	
+	return;
+}
+
+/* Bring the variables in line with a client's environment. Only the ones that
+   differ are changed, so the environment given to programs is only built
+   again if the client's isn't the same as the server's.
+   
+   Params:
+   	count - The number of entries in the client's environment
+   	entries - The entries, each NAME=value
+ */
+void server_environment(int count, char *entries[]) {
+	token_vector_t unset = { NULL, 0, 0 };
+	
+	for(int i = 0; i < count; i++) {
+		char *equals = strchr(entries[i], '=');
+		const char *value;
+		
+		if(equals == NULL)
+			continue;
+		
+		*equals = '\0';
+		
+		if((value = var_get(entries[i])) == NULL || strcmp(value, equals + 1) != 0)
+			var_set(entries[i], equals + 1, true);
+		else
+			var_export(entries[i]);
+		
+		*equals = '=';
+	}
+	
+	// Exported variables the client doesn't have are removed
+	for(int i = 0; i < VAR_TABLE_SIZE; i++) {
+		for(var_t *var = var_table[i]; var != NULL; var = var->next) {
+			bool found = false;
+			
+			for(int j = 0; j < count && var->exported && !found; j++)
+				found = (strncmp(entries[j], var->entry, var->name_length + 1) == 0);
+			
+			if(var->exported && !found)
+				token_vector_add(&unset, strndup(var->entry, var->name_length));
+		}
+	}
+	
+	for(int i = 0; i < unset.count; i++) {
+		var_unset(unset.tokens[i]);
+		free(unset.tokens[i]);
+	}
+	
+	free(unset.tokens);
+	
+	return;
+}
+
+/* Run a client's request in a worker, never returning
+   
+   The request is a server_header_t, sent with the client's standard input,
+   output and error, followed by its working directory, command and
+   environment, each terminated by a '\0'. Only clients run by the server's
+   own user are served, as their commands run with its privileges.
+   
+   Params:
+   	connection - The connection to the client
+ */
+void server_worker(int connection) {
+	char control[CMSG_SPACE(3 * sizeof(int))];
+	server_header_t header;
+	struct iovec data = { &header, sizeof(header) };
+	struct msghdr message;
+	struct cmsghdr *fds;
+	token_vector_t entries = { NULL, 0, 0 };
+	struct ucred peer;
+	socklen_t peer_length = sizeof(peer);
+	input_t input;
+	char *request;
+	ssize_t length;
+	
+	if(getsockopt(connection, SOL_SOCKET, SO_PEERCRED, &peer, &peer_length) == -1 ||
+		peer.uid != getuid()) {
+		fprintf(stderr, "server: refused a client run by another user\n");
+		_exit(2);
+	}
+	
+	memset(&message, 0, sizeof(message));
+	message.msg_iov = &data;
+	message.msg_iovlen = 1;
+	message.msg_control = control;
+	message.msg_controllen = sizeof(control);
+	
+	while((length = recvmsg(connection, &message, MSG_CMSG_CLOEXEC)) == -1 && errno == EINTR)
+		;
+	
+	fds = CMSG_FIRSTHDR(&message);
+	
+	if(length <= 0 || fds == NULL || fds->cmsg_type != SCM_RIGHTS ||
+		fds->cmsg_len != CMSG_LEN(3 * sizeof(int)) ||
+		!server_read(connection, (char *)&header + length, sizeof(header) - length) ||
+		header.version != SERVER_VERSION || header.length > SERVER_REQUEST_LIMIT) {
+		fprintf(stderr, "server: bad request\n");
+		_exit(2);
+	}
+	
+	// The client's descriptors take the place of the server's
+	for(int i = 0; i < 3; i++) {
+		int fd;
+		
+		memcpy(&fd, CMSG_DATA(fds) + i * sizeof(int), sizeof(int));
+		dup2(fd, i);
+		close(fd);
+	}
+	
+	// The length was checked against SERVER_REQUEST_LIMIT, so this can't wrap
+	if((request = malloc((size_t)header.length + 1)) == NULL) {
+		fprintf(stderr, "server: request too large\n");
+		_exit(2);
+	}
+	
+	request[header.length] = '\0';
+	
+	if(!server_read(connection, request, header.length)) {
+		fprintf(stderr, "server: bad request\n");
+		_exit(2);
+	}
+	
+	for(size_t offset = 0; offset < header.length; offset += strlen(request + offset) + 1)
+		token_vector_add(&entries, request + offset);
+	
+	if(entries.count < 2 || chdir(entries.tokens[0]) == -1) {
+		perror((entries.count < 2) ? "server: bad request" : entries.tokens[0]);
+		_exit(2);
+	}
+	
+	// $$ is the worker's own pid, not the server's it was forked from
+	var_shell_pid = getpid();
+	server_connection = connection;
+	server_environment(entries.count - 2, entries.tokens + 2);
+	
+	if(!isatty(STDOUT_FILENO))
+		setvbuf(stdout, NULL, _IOFBF, INPUT_CHUNK);
+	
+	input_open_string(&input, entries.tokens[1]);
+	run_input(&input);
+	input_close(&input);
+	
+	// This replies to the client
+	cleanup();
+	_exit(exit_status);
+}
+
+/* Run the shell as a server: its state is loaded once, then each connection
+   is handed to a worker forked from it
+   
+   Params:
+   	path - Where to create the socket, an old socket there is replaced
+   
+   Returns:
+   	The shell's exit status if the server can't carry on.
+ */
+int command_server(const char *path) {
+	struct sockaddr_un address;
+	struct pollfd fds[2];
+	struct stat info;
+	int listener;
+	int wakeup[2];
+	
+	if(!server_address(&address, path))
+		return 2;
+	
+	// Load what the first command of every worker would otherwise load, 
+	// before the socket appears so clients never wait for it
+	alias_ready();
+	
+	if((listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) == -1) {
+		perror("server: socket() failed");
+		return 1;
+	}
+	
+	// Only a socket is replaced, so a mistyped path can't remove a file
+	if(lstat(path, &info) == 0 && S_ISSOCK(info.st_mode))
+		unlink(path);
+	
+	if(bind(listener, (struct sockaddr *)&address, sizeof(address)) == -1 ||
+		listen(listener, SOMAXCONN) == -1) {
+		perror(path);
+		close(listener);
+		return 1;
+	}
+	
+	// The SIGCHLD handler writes to this, so finished workers are collected
+	// straight away (see child_wakeup)
+	if(pipe2(wakeup, O_CLOEXEC | O_NONBLOCK) == -1) {
+		perror("server: pipe() failed");
+		close(listener);
+		return 1;
+	}
+	
+	child_wakeup = wakeup[1];
+	fds[0].fd = listener;
+	fds[0].events = POLLIN;
+	fds[1].fd = wakeup[0];
+	fds[1].events = POLLIN;
+	
+	while(1) {
+		int connection;
+		pid_t pid;
+		
+		if(poll(fds, 2, -1) == -1) {
+			if(errno == EINTR)
+				continue;
+			
+			perror("server: poll() failed");
+			break;
+		}
+		
+		if(fds[1].revents != 0) {
+			char drain[64];
+			
+			while(read(wakeup[0], drain, sizeof(drain)) > 0)
+				;
+			
+			while(waitpid(-1, NULL, WNOHANG) > 0)
+				;
+		}
+		
+		if(fds[0].revents == 0)
+			continue;
+		
+		if((connection = accept4(listener, NULL, NULL, SOCK_CLOEXEC)) == -1) {
+			if(errno == EINTR || errno == ECONNABORTED || errno == EAGAIN)
+				continue;
+			
+			perror("server: accept() failed");
+			break;
+		}
+		
+		fflush(stdout);
+		fflush(stderr);
+		
+		if((pid = fork()) == 0) {
+			child_wakeup = -1;
+			close(wakeup[0]);
+			close(wakeup[1]);
+			close(listener);
+			server_worker(connection);
+		}
+		
+		if(pid == -1)
+			perror("server: fork() failed");
+		
+		close(connection);
+	}
+	
+	child_wakeup = -1;
+	close(wakeup[0]);
+	close(wakeup[1]);
+	close(listener);
+	unlink(path);
+	
+	return 1;
+}
+
+/* Run a command on a server, as if this shell had run it
+   
+   Params:
+   	path - The server's socket
+   	command - The command line
+   
+   Returns:
+   	The command's exit status, 127 if the server can't be reached or 255 if
+   	it didn't reply.
+ */
+int command_client(const char *path, const char *command) {
+	int fds[3] = { STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO };
+	char control[CMSG_SPACE(sizeof(fds))];
+	struct sockaddr_un address;
+	server_header_t header;
+	struct iovec data = { &header, sizeof(header) };
+	struct msghdr message;
+	struct cmsghdr *rights;
+	buffer_t request = { NULL, 0, 0 };
+	char *cwd = getcwd(NULL, 0);
+	int32_t status;
+	int connection;
+	
+	if(!server_address(&address, path))
+		return 127;
+	
+	if(cwd == NULL) {
+		perror("getcwd() failed");
+		return 127;
+	}
+	
+	if((connection = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) == -1 ||
+		connect(connection, (struct sockaddr *)&address, sizeof(address)) == -1) {
+		perror(path);
+		return 127;
+	}
+	
+	buffer_append(&request, cwd, strlen(cwd) + 1);
+	buffer_append(&request, command, strlen(command) + 1);
+	
+	for(char **entry = environ; *entry != NULL; entry++)
+		buffer_append(&request, *entry, strlen(*entry) + 1);
+	
+	if(request.length > SERVER_REQUEST_LIMIT) {
+		fprintf(stderr, "%s: command and environment too large\n", path);
+		return 127;
+	}
+	
+	header.version = SERVER_VERSION;
+	header.length = request.length;
+	
+	// The header carries the standard descriptors
+	memset(&message, 0, sizeof(message));
+	memset(control, 0, sizeof(control));
+	message.msg_iov = &data;
+	message.msg_iovlen = 1;
+	message.msg_control = control;
+	message.msg_controllen = sizeof(control);
+	rights = CMSG_FIRSTHDR(&message);
+	rights->cmsg_level = SOL_SOCKET;
+	rights->cmsg_type = SCM_RIGHTS;
+	rights->cmsg_len = CMSG_LEN(sizeof(fds));
+	memcpy(CMSG_DATA(rights), fds, sizeof(fds));
+	
+	if(sendmsg(connection, &message, MSG_NOSIGNAL) != sizeof(header) ||
+		!server_write(connection, request.data, request.length)) {
+		perror(path);
+		return 127;
+	}
+	
+	free(request.data);
+	free(cwd);
+	
+	if(!server_read(connection, &status, sizeof(status))) {
+		fprintf(stderr, "%s: no reply from the server\n", path);
+		return 255;
+	}
+	
+	close(connection);
+	
+	return status;
+}
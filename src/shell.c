@@ -0,0 +1,235 @@
+/*
+ * shell.c
+ *
+ * CS210 Semester 2 Shell Project
+ *
+ * Running lines of input, and the state of the shell as a whole.
+ *
+ * Authors:
+ *	Mark Anderson <mark.anderson@strath.ac.uk>
+ *	Andrew Logan <andrew.logan@strath.ac.uk>
+ *	John Meikle <john.meikle@strath.ac.uk>
+ *
+ * Version:
+ *	0.9-stage9
+ *
+ */
+
+#include "shell.h"
+
+// Environment code
+char *env_home = NULL;
+char *env_path_current = NULL;
+
+// Set when reading commands from a terminal
+bool interactive = false;
+
+// Set in a child shell that is running a builtin as part of a pipeline
+bool subshell = false;
+
+/* Execute clean up code */
+void cleanup() {
+	// Write out the telemetry records still waiting
+	if(telemetry_fd != -1)
+		telemetry_flush();
+	
+	// A server's worker tells its client how the command went
+	server_reply();
+	
+	if(!interactive)
+		// Batch runs don't change the saved aliases or history
+		return;
+	
+	// Save aliases if they've changed, the history has been saved as it went
+	// along
+	if(alias_changed)
+		save_aliases();
+	
+	return;
+}
+
+/* Run one line of input
+   
+   Interactive input is checked for history invocations (!!, !<no>, !<text> 
+   and !?<text>?) and recorded in the history, batch input is run as it is.
+   
+   Params:
+   	buffer - The line, without its trailing new line. It is modified in the
+   		process of running it.
+ */
+void run_line(char *buffer) {
+	char *full_command = NULL;
+	char *history_command = NULL;
+	bool history_invoke = false;
+	
+	// Tokens are views into the line, which are only turned into strings in
+	// place once the line is known to be needed
+	token_list_t tokens = { NULL, NULL, 0, 0 };
+	char **token_list;
+	int token_count;
+	
+	if(!interactive) {
+		// Batch input doesn't use the history, so no copy is needed
+		if((token_count = tokenize(buffer, &tokens)) > 0)
+			parse_tokens(token_count, tokens.words);
+		
+		token_list_free(&tokens);
+		alias_release();
+		return;
+	}
+	
+	// Copy the raw input over to full_command to preserve the original input
+	full_command = malloc(strlen(buffer) + 1);
+	strcpy(full_command, buffer);
+	
+	// Tokenize the user input and store the tokens in an array for easy 
+	// parsing
+	token_count = tokenize(buffer, &tokens);
+	token_list = tokens.words;
+	
+	if(token_count <= 0) {
+		token_list_free(&tokens);
+		free(full_command);
+		alias_release();
+		return;
+	}
+	
+	if(full_command[0] == '!')
+		history_ready();
+	
+	if(strcmp(full_command, "!!") == 0) {
+		// Previous history invokation (i.e. !! was entered)
+		if(history_count == 0)
+			// There's no recorded history
+			printf("There are no commands stored in history\n");
+		else if((history_command = history_previous(history_count)) != NULL)
+			history_invoke = true;
+		else
+			printf("warning: no previous history\n");
+	}
+	else if(full_command[0] == '!' && full_command[1] != '!' && 
+		full_command[1] != '\0' && (full_command[1] < '0' || full_command[1] > '9')) {
+		// Search invokation, either !<text> for a command starting with text or
+		// !?<text>? for a command containing it
+		bool prefix = (full_command[1] != '?');
+		char *text = malloc(strlen(full_command));
+		size_t length;
+		int match;
+		
+		if(text == NULL) {
+			fprintf(stderr, "error: out of memory\n");
+			token_list_free(&tokens);
+			free(full_command);
+			alias_release();
+			return;
+		}
+		
+		strcpy(text, full_command + (prefix ? 1 : 2));
+		length = strlen(text);
+		
+		if(!prefix && length > 0 && text[length - 1] == '?')
+			text[length - 1] = '\0';
+		
+		if(*text != '\0' && history_search(text, prefix, &match, 1) == 1) {
+			history_command = history_get(match);
+			history_invoke = true;
+		}
+		else
+			fprintf(stderr, "error: no command in history %s '%s'\n", 
+				prefix ? "starts with" : "contains", text);
+		
+		free(text);
+	}
+	else if(full_command[0] == '!' && !(full_command[1] == '!')) {
+		if(history_count == 0)
+			printf("There are no commands stored in history\n");
+		else {
+			// Possibly a number passed for history invokation
+			char *history_str_number = full_command + 1;
+			int history_number = atoi(history_str_number);
+			
+			if(history_number <= 0 || (history_number > history_count))
+				// Failed - either invalid number passed or 0
+				fprintf(stderr, "error: invalid history number\n");
+			else if(history_number < (int)history_first)
+				fprintf(stderr, "error: history number %d is no longer held\n", 
+					history_number);
+			else if((history_command = history_previous(history_number)) != NULL)
+				history_invoke = true;
+			else
+				fprintf(stderr, "error: can't find any previous historical commands\n");
+		}
+	}
+	
+	if(history_invoke) {
+		// Place new instruction into token_list, working on a copy so the 
+		// history entry itself isn't altered
+		buffer = realloc(full_command, strlen(history_command) + 1);
+		full_command = buffer;
+		strcpy(buffer, history_command);
+		
+		token_count = tokenize(buffer, &tokens);
+		token_list = tokens.words;
+	}
+	else {	
+		// Only track non-history commands
+		history_add(full_command);
+	}
+	
+	// Now parse the token(s)
+	if(token_count > 0)
+		parse_tokens(token_count, token_list);
+	
+	token_list_free(&tokens);
+	free(full_command);
+	alias_release();
+	
+	return;
+}
+
+/* Read lines from an input and run them until the input ends
+   
+   Params:
+   	input - The input to read from
+ */
+void run_input(input_t *input) {
+	char *line = NULL;
+	size_t line_size = 0;
+	
+	while(1) {
+		const char *text;
+		size_t length;
+		
+		// Collect any background jobs that have finished, which are only
+		// reported when interactive
+		jobs_notify();
+		
+		if(interactive) {
+			printf("$ ");
+			fflush(stdout);
+		}
+		
+		if((text = input_getline(input, &length)) == NULL) {
+			// Input has ended, can't continue, end loop
+			if(interactive)
+				printf("\n");
+			
+			break;
+		}
+		
+		// Copy the line out of the input buffer so it can be tokenized in place
+		if(length + 1 > line_size) {
+			line_size = length + 1;
+			line = realloc(line, line_size);
+		}
+		
+		memcpy(line, text, length);
+		line[length] = '\0';
+		
+		run_line(line);
+	}
+	
+	free(line);
+	
+	return;
+}
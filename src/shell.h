@@ -0,0 +1,730 @@
+/*
+ * shell.h
+ *
+ * CS210 Semester 2 Shell Project
+ *
+ * Declarations shared by the shell's source files.
+ *
+ * Authors:
+ *	Mark Anderson <mark.anderson@strath.ac.uk>
+ *	Andrew Logan <andrew.logan@strath.ac.uk>
+ *	John Meikle <john.meikle@strath.ac.uk>
+ *
+ * Version:
+ *	0.9-stage9
+ *
+ */
+
+#ifndef SHELL_H
+#define SHELL_H
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <spawn.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <poll.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <sys/syscall.h>
+
+#define PATH_MAX	512
+#define HISTORY_DEFAULT	10000
+#define HISTORY_LIMIT	1000000
+#define HISTORY_AVERAGE	64
+#define HISTORY_SLAB_SIZE	65536
+#define HISTORY_ENTRY_LIMIT	1048576
+#define HISTORY_INDEX_SIZE	16384
+#define PATH_CACHE_SIZE	64
+#define BUILTIN_TABLE_SIZE	128
+#define BUILTIN_LENGTH_FACTOR	2
+#define BUILTIN_FIRST_FACTOR	33
+#define VAR_TABLE_SIZE	256
+#define GLOB_CACHE_SIZE	32
+#define GLOB_BUFFER	262144
+#define GLOB_RACY	1.0
+#define SERVER_VERSION	1
+#define SERVER_REQUEST_LIMIT	16777216
+#define SHELL_VERSION	"0.9-stage9"
+#define SCRIPT_MAGIC	"SHSC"
+#define SCRIPT_FORMAT	2
+#define SCRIPT_RAW	0xffffffffu
+#define SCRIPT_RACY	1.0
+#define INPUT_CHUNK	65536
+#define TELEMETRY_RING	64
+#define TELEMETRY_COMMAND	256
+#define TELEMETRY_BUCKETS	8
+#define TELEMETRY_DEPTHS	8
+
+// The characters that are expanded ($, *, ? and [) are replaced by these,
+// in the same order, when they're quoted, and put back once a word has been
+// expanded (see quote_character())
+#define EXPANDED_CHARACTERS	"$*?["
+#define QUOTED_CHARACTERS	"\001\002\003\004"
+#define QUOTED_DOLLAR	'\001'
+
+// A $ within double quotes is replaced by this, so the value it expands to is
+// quoted too (see var_expand())
+#define QUOTED_EXPANSION	'\005'
+#define MARKED_CHARACTERS	QUOTED_CHARACTERS "\005"
+
+#ifdef __GLIBC__
+#if __GLIBC_PREREQ(2, 35)
+#define HAVE_SPAWN_TCSETPGRP
+#endif
+#endif
+
+extern char **environ;
+
+// Defines a token as a view into the line it was read from
+typedef struct {
+	size_t offset;
+	size_t length;
+	char *operator;		// the operator's token string, NULL for a word
+	bool escaped;		// contains quotes or backslashes to be removed
+} token_t;
+
+// Defines a growable list of the tokens from a line
+typedef struct {
+	token_t *views;
+	char **words;		// token strings, see token_strings()
+	int count;
+	int size;
+} token_list_t;
+
+// Defines a growable array of token strings
+typedef struct {
+	char **tokens;
+	int count;
+	int size;
+} token_vector_t;
+
+// Defines the states of a slot in the alias table
+typedef enum {
+	ALIAS_EMPTY,
+	ALIAS_USED,
+	ALIAS_DELETED
+} alias_state_t;
+
+// Defines an alias, its name and value are stored in the alias arena
+typedef struct {
+	alias_state_t state;
+	unsigned int hash;
+	size_t key;		// offset of the name in the arena
+	size_t value;		// offset of the value in the arena
+	size_t tokens;		// offset of the pre-split value in the arena
+	int token_count;
+	char **expansion;	// cached full expansion, see alias_expansion()
+	int expansion_count;
+	int expansion_depth;	// how deeply aliases are nested in the expansion
+	unsigned int expansion_generation;
+} alias_t;
+
+// Defines a way of storing a command in history
+typedef struct {
+	int number; 
+	char *string;
+	bool owned;
+} history_t;
+
+// Defines a list of the history numbers of the commands containing a trigram
+typedef struct {
+	int *numbers;
+	int start;
+	int count;
+	int size;
+} history_posting_t;
+
+// Defines a cached mapping from a command name to its location in PATH
+typedef struct path_entry {
+	char *name;
+	char *path;
+	unsigned int hits;
+	struct path_entry *next;
+} path_entry_t;
+
+// Defines a shell variable, stored as NAME=value so it can go straight into
+// the environment of the programs the shell starts
+typedef struct var {
+	char *entry;
+	size_t name_length;
+	bool exported;
+	struct var *next;
+} var_t;
+
+// Defines the start of a request to a shell server, which is followed by 
+// length bytes of '\0' terminated strings (see server_worker())
+typedef struct {
+	uint32_t version;
+	uint32_t length;
+} server_header_t;
+
+// Defines the start of a script's parsed form, which is followed by the
+// script's full path and then length bytes of its lines (see script_compile())
+typedef struct {
+	char magic[4];		// SCRIPT_MAGIC
+	uint32_t format;	// SCRIPT_FORMAT
+	char version[16];	// SHELL_VERSION
+	uint64_t size;		// the script's size and modification time
+	int64_t modified;
+	int64_t modified_ns;
+	uint32_t path_length;
+	uint32_t line_count;
+	uint64_t length;
+} script_header_t;
+
+// Defines a directory entry as getdents64() returns it
+typedef struct {
+	uint64_t d_ino;
+	int64_t d_off;
+	unsigned short d_reclen;
+	unsigned char d_type;
+	char d_name[];
+} glob_dirent_t;
+
+// Defines an entry of a cached directory listing. The key holds the first 8
+// bytes of the name, so most comparisons when sorting don't need strcmp().
+typedef struct {
+	uint64_t key;
+	uint32_t name;		// offset of the name in the listing's names
+	uint16_t length;	// length of the name
+	unsigned char type;	// d_type, e.g. DT_DIR
+} glob_entry_t;
+
+// Defines a cached directory listing, sorted by name, which is used for as 
+// long as the directory's modification time doesn't change
+typedef struct {
+	char *path;
+	dev_t device;
+	ino_t inode;
+	struct timespec modified;
+	struct timespec read;	// when the listing was read
+	char *names;
+	glob_entry_t *entries;
+	int count;
+	int busy;		// the number of globs walking the listing
+	unsigned long used;	// when the listing was last used, see glob_clock
+} glob_dir_t;
+
+// Defines the ways an external process can be started
+typedef enum {
+	LAUNCHER_SPAWN,
+	LAUNCHER_FORK
+} launcher_t;
+
+// Defines a redirection of one of a command's standard descriptors
+typedef struct {
+	char *operator;		// the operator's token string (e.g. token_output)
+	char *target;		// the file, NULL for 2>&1
+} redirect_t;
+
+// Defines a single command of a pipeline
+typedef struct {
+	int argc;
+	char **argv;
+	redirect_t *redirects;	// applied in order, after the pipes
+	int redirect_count;
+	bool external;		// run as a program even if it's a builtin's name
+} command_t;
+
+// Defines a builtin command, run by a handler returning its exit status
+typedef struct {
+	const char *name;
+	int (*handler)(int argc, char *argv[]);
+	const char *description;
+} builtin_t;
+
+// Stores the builtin commands (see builtin_find for the lookup)
+extern const builtin_t builtins[];
+extern const builtin_t *const builtin_table[BUILTIN_TABLE_SIZE];
+
+// Defines how a pipeline stage is to be set up when it is started
+typedef struct {
+	int in;			// descriptor for standard input, or -1 to inherit it
+	int out;		// descriptor for standard output, or -1 to inherit it
+	pid_t pgid;		// process group to join, 0 for a new one, -1 to inherit
+	bool foreground;	// whether the process group takes the terminal
+	const redirect_t *redirects;	// the stage's redirections, see redirects_open()
+	const int *redirect_fds;
+	int redirect_count;
+} stage_setup_t;
+
+// Defines the kinds of command telemetry is kept for
+typedef enum {
+	TELEMETRY_BUILTIN,
+	TELEMETRY_ALIAS,
+	TELEMETRY_EXTERNAL
+} telemetry_kind_t;
+
+// Defines the telemetry record of one command
+typedef struct {
+	char command[TELEMETRY_COMMAND];	// the command line, truncated to fit
+	telemetry_kind_t kind;
+	int alias_depth;	// how deeply aliases were nested, 0 for none
+	double time;		// when it was started, in seconds since the epoch
+	double started;		// when it was started, see clock_seconds()
+	double spawn;		// seconds taken to start its processes
+	double run;		// seconds from starting it to its completion
+	int processes;		// processes started, 0 for a builtin run in the shell
+	int status;		// exit status, 128 + the signal number if killed
+	unsigned long path_hits;	// PATH cache lookups made starting it
+	unsigned long path_misses;
+} telemetry_record_t;
+
+// Defines the counters shown by the stats command
+typedef struct {
+	unsigned long commands[3];	// indexed by telemetry_kind_t
+	unsigned long failed;
+	unsigned long path_hits;
+	unsigned long path_misses;
+	unsigned long depths[TELEMETRY_DEPTHS];
+	unsigned long run[TELEMETRY_BUCKETS];	// see telemetry_bucket()
+	unsigned long spawn[TELEMETRY_BUCKETS];
+} telemetry_stats_t;
+
+// Defines a process started as part of a job
+typedef struct {
+	pid_t pid;
+	bool done;
+	bool stopped;
+	int status;
+	struct rusage usage;	// resource usage, collected once it's done
+} job_process_t;
+
+// Defines the states a job can be in
+typedef enum {
+	JOB_RUNNING,
+	JOB_STOPPED,
+	JOB_DONE
+} job_state_t;
+
+// Defines a pipeline that has been started by the shell
+typedef struct {
+	int number;		// job number, 0 when the slot is free
+	pid_t pgid;
+	job_process_t *processes;
+	int count;
+	char *command;
+	bool timed;		// whether to report its resource usage when done
+	double started;		// when it was started, see clock_seconds()
+	telemetry_record_t record;
+} job_t;
+
+// Defines a growable buffer of bytes
+typedef struct {
+	char *data;
+	size_t length;
+	size_t size;
+} buffer_t;
+
+// Defines a command being run by the parallel command
+typedef struct {
+	char *command;		// NULL when the slot is free
+	pid_t pid;
+	bool reaped;
+	int status;		// the status reported by waitpid()
+	int out;		// pipe from its standard output, -1 once closed
+	int err;		// pipe from its standard error, -1 once closed
+	buffer_t output;
+	buffer_t errors;
+} parallel_job_t;
+
+// Defines the state of a test expression being evaluated
+typedef struct {
+	char **argv;
+	int argc;
+	int position;		// the next argument to be looked at
+	const char *name;	// "test" or "[", for error messages
+	bool error;
+} test_state_t;
+
+// Defines the state of the printf command's arguments
+typedef struct {
+	char **argv;
+	int argc;
+	int next;		// the next argument to be used
+	int status;
+} printf_state_t;
+
+// Defines a source of command lines
+typedef struct {
+	int fd;			// descriptor to read from, -1 if buffer holds everything
+	char *buffer;
+	size_t start;		// start of the unread data in buffer
+	size_t end;		// end of the valid data in buffer
+	size_t size;		// allocated (or mapped) size of buffer
+	bool mapped;
+} input_t;
+
+// input.c
+void input_open_fd(input_t *input, int fd);
+void input_open_string(input_t *input, const char *string);
+bool input_open_file(input_t *input, const char *path);
+const char *input_getline(input_t *input, size_t *length);
+void input_close(input_t *input);
+
+// lexer.c
+extern char token_and[];
+extern char token_or[];
+extern char token_pipe[];
+extern char token_background[];
+extern char token_semicolon[];
+extern char token_input[];
+extern char token_output[];
+extern char token_append[];
+extern char token_error[];
+extern char token_error_output[];
+extern char *operators[];
+extern bool lexer_quiet;
+
+char *operator_match(const char *text);
+bool is_operator(const char *token);
+bool is_separator(const char *token);
+bool lex_line(const char *line, token_list_t *list);
+char quote_character(char c);
+char unquote_character(char c);
+void unquote_word(char *word);
+size_t unescape_word(char *word, size_t length);
+char **token_strings(char *line, token_list_t *list);
+int tokenize(char *line, token_list_t *list);
+void token_list_free(token_list_t *list);
+char *join_words(int count, char *words[]);
+void token_vector_add(token_vector_t *vector, char *token);
+
+// path.c
+extern path_entry_t *path_cache[PATH_CACHE_SIZE];
+extern unsigned long path_cache_hits;
+extern unsigned long path_cache_misses;
+
+unsigned int hash_string(const char *key);
+char *home_file(const char *name);
+char *path_search(const char *name);
+path_entry_t *path_cache_add(const char *name, char *path);
+path_entry_t *path_cache_find(const char *name);
+void path_cache_remove(const char *name);
+void path_cache_clear();
+const char *path_lookup(const char *name);
+
+// history.c
+extern history_t *history_value;
+extern int history_capacity;
+extern unsigned int history_count;
+extern unsigned int history_first;
+extern char **history_slabs;
+extern int history_slab_count;
+extern int history_slab;
+extern size_t history_slab_used;
+extern history_posting_t history_index[HISTORY_INDEX_SIZE];
+extern int history_index_added;
+extern bool history_loaded;
+extern int history_log_fd;
+extern size_t history_log_size;
+extern unsigned int history_log_lines;
+
+unsigned int history_trigram(unsigned char a, unsigned char b, unsigned char c);
+void history_posting_trim(history_posting_t *posting);
+void history_index_add(int number, const char *command);
+void history_slab_clear(const char *slab, int number);
+char *history_slab_alloc(size_t length, int number);
+void history_store(int number, const char *command);
+char *history_get(int number);
+char *history_previous(int number);
+int history_search(const char *text, bool prefix, int matches[], int max);
+void history_log_open();
+void history_log_compact();
+void history_log_append(int number, const char *command);
+void history_add(const char *command);
+void history_load();
+void history_ready();
+void history_init();
+
+// alias.c
+extern alias_t *alias_table;
+extern unsigned int alias_slots;
+extern unsigned int alias_used;
+extern char *alias_arena;
+extern size_t alias_arena_length;
+extern size_t alias_arena_size;
+extern size_t alias_arena_waste;
+extern char *alias_retired;
+extern unsigned int alias_generation;
+extern unsigned int alias_count;
+extern int alias_depth;
+extern bool alias_loaded;
+extern bool alias_changed;
+
+alias_t *alias_slot(const char *key, unsigned int hash);
+size_t alias_arena_append(const void *data, size_t length);
+size_t alias_arena_add(const char *string);
+void alias_retire(char *block);
+void alias_release();
+size_t alias_tokens_length(const char *tokens, int count);
+bool alias_split(alias_t *alias, const char *value);
+void alias_discard(alias_t *alias, bool key);
+int alias_compare(const void *a, const void *b);
+alias_t **alias_list();
+void alias_arena_compact();
+void alias_table_resize(unsigned int slots);
+alias_t *alias_find(const char *key);
+char *alias_get(const char *key);
+bool alias_add(const char *key, const char *value);
+bool alias_remove(const char *key);
+void alias_record_depth(int first, const token_vector_t *output, int depth);
+void alias_expand_into(int count, char *tokens[], alias_t *active[], int depth,
+	token_vector_t *output);
+char **alias_expansion(alias_t *alias);
+void alias_decode(const alias_t *alias, char *tokens[]);
+int alias_expand(int count, char *tokens[], char ***expanded, int **depths);
+void alias_print();
+void alias_init();
+void alias_ready();
+void save_aliases();
+
+// builtins.c
+void command_history();
+void command_history_search(const char *text);
+bool command_unalias(const char *command);
+bool command_alias(const char *command1, const char *command2);
+bool command_cd(const char *path);
+void command_getpath();
+void command_setpath(const char *path);
+void command_hash(int count, char *args[]);
+void command_launcher(const char *name);
+void command_pwd();
+void command_help();
+void command_timing(const char *mode);
+int builtin_cd(int argc, char *argv[]);
+int builtin_pwd(int argc, char *argv[]);
+int builtin_getpath(int argc, char *argv[]);
+int builtin_setpath(int argc, char *argv[]);
+int builtin_history(int argc, char *argv[]);
+int builtin_alias(int argc, char *argv[]);
+int builtin_unalias(int argc, char *argv[]);
+int builtin_export(int argc, char *argv[]);
+int builtin_unset(int argc, char *argv[]);
+int builtin_exit(int argc, char *argv[]);
+int builtin_help(int argc, char *argv[]);
+int builtin_hash(int argc, char *argv[]);
+int builtin_launcher(int argc, char *argv[]);
+int builtin_jobs(int argc, char *argv[]);
+int builtin_fg(int argc, char *argv[]);
+int builtin_bg(int argc, char *argv[]);
+int builtin_wait(int argc, char *argv[]);
+int builtin_time(int argc, char *argv[]);
+int builtin_timing(int argc, char *argv[]);
+int builtin_parallel(int argc, char *argv[]);
+int builtin_echo(int argc, char *argv[]);
+int builtin_true(int argc, char *argv[]);
+int builtin_false(int argc, char *argv[]);
+int builtin_test(int argc, char *argv[]);
+int builtin_printf(int argc, char *argv[]);
+int builtin_command(int argc, char *argv[]);
+int builtin_stats(int argc, char *argv[]);
+int builtin_telemetry(int argc, char *argv[]);
+unsigned int builtin_slot(const char *name, size_t length);
+const builtin_t *builtin_find(const char *name);
+
+// jobs.c
+extern job_t *jobs;
+extern int job_slots;
+extern volatile sig_atomic_t child_changed;
+extern volatile sig_atomic_t child_wakeup;
+extern bool job_control;
+extern pid_t shell_pgid;
+
+void job_process_update(job_process_t *process, int status);
+pid_t job_process_wait(job_process_t *process, int options);
+void job_report(const job_t *job);
+job_state_t job_state(const job_t *job);
+int job_status(const job_t *job);
+job_t *job_add(int count, const char *command);
+void job_remove(job_t *job);
+job_t *job_find(const char *spec);
+void jobs_update();
+void jobs_notify();
+int job_wait(job_t *job);
+void job_continue(job_t *job);
+void command_jobs();
+int command_fg(const char *spec);
+bool command_bg(const char *spec);
+bool command_wait(int count, char *specs[]);
+void sigchld_handler(int signal_number);
+void job_control_init();
+
+// telemetry.c
+extern telemetry_stats_t telemetry_stats;
+extern int telemetry_fd;
+extern char *telemetry_file;
+extern telemetry_record_t telemetry_ring[TELEMETRY_RING];
+extern int telemetry_pending;
+extern int telemetry_alias_depth;
+extern const char *telemetry_kinds[];
+
+int telemetry_bucket(double seconds);
+void telemetry_start(telemetry_record_t *record, telemetry_kind_t kind);
+void telemetry_command(telemetry_record_t *record, int count, char *words[]);
+void telemetry_spawned(telemetry_record_t *record, int processes);
+void telemetry_finish(telemetry_record_t *record, int status);
+size_t telemetry_json_string(char *output, const char *string);
+void telemetry_flush();
+bool telemetry_open(const char *file);
+void telemetry_histogram(const char *title, const char *labels[], 
+	const unsigned long counts[], int count);
+void command_stats(bool reset);
+bool command_telemetry(const char *file);
+
+// utilities.c
+int hex_value(char c);
+void put_utf8(unsigned long code);
+size_t put_escape(const char *text, bool octal_0, bool *stop);
+void test_error(test_state_t *test, const char *format, const char *argument);
+const char *test_integer(test_state_t *test, const char *text, bool *negative, 
+	size_t *length);
+int test_compare(test_state_t *test, const char *left, const char *right);
+int test_integer_operator(const char *word);
+bool test_is_unary(const char *word);
+bool test_is_binary(const char *word);
+bool test_unary(test_state_t *test, const char *operator, const char *operand);
+bool test_binary(test_state_t *test, const char *left, const char *operator, 
+	const char *right);
+bool test_binary_length(test_state_t *test, bool left_length);
+bool test_primary(test_state_t *test);
+bool test_not(test_state_t *test);
+bool test_and(test_state_t *test);
+bool test_or(test_state_t *test);
+bool test_posix(test_state_t *test);
+void printf_number(printf_state_t *state, bool is_float, bool is_signed, void *value);
+bool printf_format(printf_state_t *state, const char *format, bool *stop);
+
+// variables.c
+extern var_t *var_table[VAR_TABLE_SIZE];
+extern unsigned long var_generation;
+extern pid_t var_shell_pid;
+
+unsigned int var_hash(const char *name, size_t length);
+size_t var_name_length(const char *name);
+bool var_valid_name(const char *word);
+bool is_assignment(const char *word);
+var_t *var_find(const char *name, size_t length);
+const char *var_get(const char *name);
+void var_changed(const char *name, const char *value);
+void var_set(const char *name, const char *value, bool export);
+void var_export(const char *name);
+void var_unset(const char *name);
+void var_init();
+char **var_environment();
+char *var_expand(const char *word);
+int var_compare(const void *a, const void *b);
+void var_print_exports();
+bool command_export(int count, char *args[]);
+bool command_unset(int count, char *args[]);
+void command_assign(int count, char *words[]);
+
+// glob.c
+extern glob_dir_t glob_cache[GLOB_CACHE_SIZE];
+extern unsigned long glob_cache_hits;
+extern unsigned long glob_cache_misses;
+
+const char *glob_bracket_end(const char *pattern);
+bool glob_has_pattern(const char *pattern, const char *end);
+bool glob_match_one(const char **pattern, const char *end, char c);
+bool glob_match(const char *pattern, const char *end, const char *name);
+int glob_entry_compare(const void *a, const void *b);
+bool glob_read(glob_dir_t *dir, const char *path);
+glob_dir_t *glob_listing(const char *path);
+void glob_range(glob_dir_t *dir, const char *pattern, const char *end, int *first, 
+	int *last);
+void glob_walk(buffer_t *path, const char *pattern, token_vector_t *matches);
+int glob_expand(const char *word, token_vector_t *matches);
+
+// server.c
+extern int server_connection;
+
+bool server_address(struct sockaddr_un *address, const char *path);
+bool server_read(int fd, void *data, size_t length);
+bool server_write(int fd, const void *data, size_t length);
+void server_reply();
+void server_environment(int count, char *entries[]);
+void server_worker(int connection);
+int command_server(const char *path);
+int command_client(const char *path, const char *command);
+
+// script.c
+char *script_cache_file(const char *path);
+void script_header(script_header_t *header, const char *path, const struct stat *info);
+bool script_compile(const char *path, const struct stat *info, buffer_t *image);
+void script_cache_save(char *file, const buffer_t *image);
+bool script_check(const char *position, const char *end, uint32_t line_count);
+char *script_cache_load(const char *file, const char *path, const struct stat *info,
+	size_t *length);
+void script_execute(char *image, size_t length);
+bool script_run(const char *path);
+
+// redirect.c
+bool is_redirect(const char *token);
+int redirect_target(const redirect_t *redirect);
+bool redirects_open(int count, const redirect_t redirects[], int fds[]);
+void redirects_close(int count, const redirect_t redirects[], int fds[]);
+bool redirects_swap(int count, const redirect_t redirects[], int saved[3]);
+void redirects_restore(int saved[3]);
+
+// parallel.c
+void buffer_append(buffer_t *buffer, const char *data, size_t length);
+void parallel_exec(char *command);
+bool parallel_start(parallel_job_t *job);
+void parallel_read(int *fd, buffer_t *buffer);
+int parallel_finish(parallel_job_t *job);
+char *parallel_next(int count, char *commands[], int next, input_t *input);
+int command_parallel(int limit, int count, char *commands[], input_t *input);
+
+// exec.c
+extern launcher_t launcher;
+extern bool timing;
+extern int exit_status;
+
+double clock_seconds();
+void usage_add(struct rusage *total, const struct rusage *usage);
+void usage_report(const char *command, double real, const struct rusage *usage, 
+	bool verbose);
+
+void stage_setup_child(const stage_setup_t *setup);
+pid_t launch_process(const char *path, char *argv[], const stage_setup_t *setup);
+pid_t start_process(char *argv[], const stage_setup_t *setup);
+pid_t start_builtin(int argc, char *argv[], const stage_setup_t *setup);
+int execute_pipeline(int count, command_t commands[], bool background, bool timed);
+int run_tokens(int token_count, char *token_list[]);
+int run_stages(int token_count, char *token_list[], command_t commands[], 
+	redirect_t redirects[], bool timed);
+bool is_expandable(const char *word);
+void expand_word(char *word, bool pattern, token_vector_t *words, 
+	token_vector_t *copies);
+int run_list(int token_count, char *token_list[], const int depths[]);
+void parse_tokens(int token_count, char *token_list[]);
+
+// shell.c
+extern char *env_home;
+extern char *env_path_current;
+extern bool interactive;
+extern bool subshell;
+
+void cleanup();
+void run_line(char *buffer);
+void run_input(input_t *input);
+
+#endif
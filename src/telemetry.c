@@ -0,0 +1,367 @@
+/*
+ * telemetry.c
+ *
+ * CS210 Semester 2 Shell Project
+ *
+ * Per-command telemetry: the counters behind the stats command and an opt-in
+ * log of one JSON record per command.
+ *
+ * Authors:
+ *	Mark Anderson <mark.anderson@strath.ac.uk>
+ *	Andrew Logan <andrew.logan@strath.ac.uk>
+ *	John Meikle <john.meikle@strath.ac.uk>
+ *
+ * Version:
+ *	0.9-stage9
+ *
+ */
+
+#include "shell.h"
+
+// Stores the counters shown by stats, always collected
+telemetry_stats_t telemetry_stats;
+
+// Stores the log's descriptor and name, -1 and NULL when it's off
+int telemetry_fd = -1;
+char *telemetry_file = NULL;
+
+// Stores the records waiting to be written to the log, which is done in
+// batches of TELEMETRY_RING so logging costs one write() per batch
+telemetry_record_t telemetry_ring[TELEMETRY_RING];
+int telemetry_pending = 0;
+
+// Stores how deeply aliases were nested to give the command being run, 0 if
+// it didn't come from an alias (set by run_list())
+int telemetry_alias_depth = 0;
+
+// Stores the names of the kinds of command, as they appear in the log
+const char *telemetry_kinds[] = { "builtin", "alias", "external" };
+
+/* Get the histogram bucket of a duration, buckets go up in powers of ten from
+   under 10us to 10s and over
+   
+   Params:
+   	seconds - The duration
+   
+   Returns:
+   	The bucket, from 0 to TELEMETRY_BUCKETS - 1.
+ */
+int telemetry_bucket(double seconds) {
+	double limit = 1e-5;
+	int bucket = 0;
+	
+	while(bucket < TELEMETRY_BUCKETS - 1 && seconds >= limit) {
+		limit *= 10;
+		bucket++;
+	}
+	
+	return bucket;
+}
+
+/* Start the record of a command
+   
+   Params:
+   	record - The record to start
+   	kind - The kind of command, which is recorded as an alias instead if the
+   		command came from one (see telemetry_alias_depth)
+ */
+void telemetry_start(telemetry_record_t *record, telemetry_kind_t kind) {
+	struct timespec now;
+	
+	clock_gettime(CLOCK_REALTIME, &now);
+	
+	record->command[0] = '\0';
+	record->kind = (telemetry_alias_depth > 0) ? TELEMETRY_ALIAS : kind;
+	record->alias_depth = telemetry_alias_depth;
+	record->time = now.tv_sec + now.tv_nsec / 1e9;
+	record->started = clock_seconds();
+	record->spawn = 0;
+	record->run = 0;
+	record->processes = 0;
+	record->status = 0;
+	record->path_hits = path_cache_hits;
+	record->path_misses = path_cache_misses;
+	
+	return;
+}
+
+/* Set the command of a record from its words, truncating it to fit
+   
+   Params:
+   	record - The record
+   	count - The number of words
+   	words - The words of the command
+ */
+void telemetry_command(telemetry_record_t *record, int count, char *words[]) {
+	size_t length = 0;
+	
+	for(int i = 0; i < count && length < TELEMETRY_COMMAND - 1; i++) {
+		size_t word_length = strlen(words[i]);
+		
+		if(i > 0)
+			record->command[length++] = ' ';
+		
+		if(word_length > TELEMETRY_COMMAND - 1 - length)
+			word_length = TELEMETRY_COMMAND - 1 - length;
+		
+		memcpy(record->command + length, words[i], word_length);
+		length += word_length;
+	}
+	
+	record->command[length] = '\0';
+	
+	return;
+}
+
+/* Note that a command's processes have been started, which ends its spawn
+   latency and the PATH cache lookups made for it
+   
+   Params:
+   	record - The record of the command
+   	processes - The number of processes started, 0 for a builtin run in the
+   		shell
+ */
+void telemetry_spawned(telemetry_record_t *record, int processes) {
+	record->spawn = clock_seconds() - record->started;
+	record->processes = processes;
+	record->path_hits = path_cache_hits - record->path_hits;
+	record->path_misses = path_cache_misses - record->path_misses;
+	
+	return;
+}
+
+/* Finish the record of a command, adding it to the counters and, if the log
+   is on, to the records waiting to be written
+   
+   Params:
+   	record - The record of the command
+   	status - The command's exit status
+ */
+void telemetry_finish(telemetry_record_t *record, int status) {
+	int depth = record->alias_depth;
+	
+	if(subshell)
+		// Only the shell itself keeps telemetry
+		return;
+	
+	record->run = clock_seconds() - record->started;
+	record->status = status;
+	
+	telemetry_stats.commands[record->kind]++;
+	telemetry_stats.path_hits += record->path_hits;
+	telemetry_stats.path_misses += record->path_misses;
+	telemetry_stats.depths[(depth < TELEMETRY_DEPTHS) ? depth : TELEMETRY_DEPTHS - 1]++;
+	telemetry_stats.run[telemetry_bucket(record->run)]++;
+	
+	if(record->processes > 0)
+		telemetry_stats.spawn[telemetry_bucket(record->spawn)]++;
+	
+	if(status != 0)
+		telemetry_stats.failed++;
+	
+	if(telemetry_fd == -1)
+		return;
+	
+	telemetry_ring[telemetry_pending++] = *record;
+	
+	if(telemetry_pending == TELEMETRY_RING)
+		telemetry_flush();
+	
+	return;
+}
+
+/* Add a string to a buffer as a JSON string
+   
+   Params:
+   	output - Where to add it, which must have room for 6 bytes per character
+   		plus 2
+   	string - The string
+   
+   Returns:
+   	The number of bytes added.
+ */
+size_t telemetry_json_string(char *output, const char *string) {
+	char *position = output;
+	
+	*position++ = '"';
+	
+	for(const unsigned char *c = (const unsigned char *)string; *c != '\0'; c++) {
+		if(*c == '"' || *c == '\\') {
+			*position++ = '\\';
+			*position++ = *c;
+		}
+		else if(*c < 0x20 || *c == 0x7f)
+			position += sprintf(position, "\\u%04x", *c);
+		else
+			*position++ = *c;
+	}
+	
+	*position++ = '"';
+	
+	return position - output;
+}
+
+/* Write the waiting records to the log, one line of JSON each, in a single
+   write() */
+void telemetry_flush() {
+	static char buffer[TELEMETRY_RING * (TELEMETRY_COMMAND * 6 + 256)];
+	size_t length = 0;
+	
+	for(int i = 0; i < telemetry_pending; i++) {
+		const telemetry_record_t *record = &telemetry_ring[i];
+		
+		length += sprintf(buffer + length, "{\"time\":%.6f,\"command\":", record->time);
+		length += telemetry_json_string(buffer + length, record->command);
+		length += sprintf(buffer + length,
+			",\"kind\":\"%s\",\"alias_depth\":%d,\"processes\":%d,"
+			"\"spawn_us\":%.0f,\"run_us\":%.0f,\"status\":%d,"
+			"\"path_hits\":%lu,\"path_misses\":%lu}\n",
+			telemetry_kinds[record->kind], record->alias_depth, record->processes,
+			record->spawn * 1e6, record->run * 1e6, record->status,
+			record->path_hits, record->path_misses);
+	}
+	
+	telemetry_pending = 0;
+	
+	for(size_t written = 0; written < length && telemetry_fd != -1; ) {
+		ssize_t result = write(telemetry_fd, buffer + written, length - written);
+		
+		if(result == -1 && errno == EINTR)
+			continue;
+		
+		if(result == -1) {
+			perror("warning: unable to write telemetry");
+			break;
+		}
+		
+		written += result;
+	}
+	
+	return;
+}
+
+/* Turn the telemetry log on or off, writing out any waiting records first
+   
+   Params:
+   	file - The file to append the records to, or NULL to turn the log off
+   
+   Returns:
+   	Whether the log could be opened.
+ */
+bool telemetry_open(const char *file) {
+	int fd = -1;
+	
+	if(file != NULL && (fd = open(file, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644)) == -1) {
+		perror(file);
+		return false;
+	}
+	
+	if(telemetry_fd != -1) {
+		telemetry_flush();
+		close(telemetry_fd);
+		free(telemetry_file);
+	}
+	
+	telemetry_fd = fd;
+	telemetry_file = NULL;
+	
+	if(file != NULL) {
+		telemetry_file = malloc(strlen(file) + 1);
+		strcpy(telemetry_file, file);
+	}
+	
+	return true;
+}
+
+/* Print a histogram of counts, with bars scaled to the largest count
+   
+   Params:
+   	title - The histogram's title
+   	labels - The label of each count
+   	counts - The counts
+   	count - The number of counts
+ */
+void telemetry_histogram(const char *title, const char *labels[],
+	const unsigned long counts[], int count) {
+	unsigned long largest = 0;
+	int first = count, last = 0;
+	
+	for(int i = 0; i < count; i++) {
+		if(counts[i] > largest)
+			largest = counts[i];
+		
+		if(counts[i] > 0) {
+			first = (i < first) ? i : first;
+			last = i;
+		}
+	}
+	
+	if(largest == 0)
+		return;
+	
+	printf("%s:\n", title);
+	
+	// Only the range of counts that aren't empty is shown
+	for(int i = first; i <= last; i++) {
+		int width = (int)((counts[i] * 40 + largest - 1) / largest);
+		
+		printf("\t%-8s %8lu ", labels[i], counts[i]);
+		
+		for(int j = 0; j < width; j++)
+			putchar('#');
+		
+		putchar('\n');
+	}
+	
+	return;
+}
+
+/* stats internal command
+   
+   Params:
+   	reset - Whether to reset the counters after printing them
+ */
+void command_stats(bool reset) {
+	static const char *time_labels[TELEMETRY_BUCKETS] = {
+		"<10us", "<100us", "<1ms", "<10ms", "<100ms", "<1s", "<10s", ">=10s"
+	};
+	static const char *depth_labels[TELEMETRY_DEPTHS] = {
+		"0", "1", "2", "3", "4", "5", "6", "7+"
+	};
+	telemetry_stats_t *stats = &telemetry_stats;
+	
+	printf("commands: %lu builtin, %lu alias, %lu external, %lu failed\n",
+		stats->commands[TELEMETRY_BUILTIN], stats->commands[TELEMETRY_ALIAS],
+		stats->commands[TELEMETRY_EXTERNAL], stats->failed);
+	printf("path cache: %lu hits, %lu misses\n", stats->path_hits,
+		stats->path_misses);
+	printf("glob cache: %lu hits, %lu misses\n", glob_cache_hits, glob_cache_misses);
+	telemetry_histogram("alias depth", depth_labels, stats->depths, TELEMETRY_DEPTHS);
+	telemetry_histogram("run time", time_labels, stats->run, TELEMETRY_BUCKETS);
+	telemetry_histogram("spawn latency", time_labels, stats->spawn, TELEMETRY_BUCKETS);
+	
+	if(reset) {
+		memset(stats, 0, sizeof(*stats));
+		glob_cache_hits = glob_cache_misses = 0;
+	}
+	
+	return;
+}
+
+/* telemetry internal command
+   
+   Params:
+   	file - The file to log to, "off" to stop logging, or NULL to print where
+   		the log is going
+   
+   Returns:
+   	Whether it succeeded.
+ */
+bool command_telemetry(const char *file) {
+	if(file == NULL) {
+		printf("%s\n", (telemetry_file == NULL) ? "off" : telemetry_file);
+		return true;
+	}
+	
+	return telemetry_open((strcmp(file, "off") == 0) ? NULL : file);
+}
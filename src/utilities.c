@@ -0,0 +1,1036 @@
+/*
+ * utilities.c
+ *
+ * CS210 Semester 2 Shell Project
+ *
+ * Common utilities run in the shell rather than as programs: echo, true,
+ * false, test (and [) and printf, which behave as the coreutils versions do.
+ *
+ * Authors:
+ *	Mark Anderson <mark.anderson@strath.ac.uk>
+ *	Andrew Logan <andrew.logan@strath.ac.uk>
+ *	John Meikle <john.meikle@strath.ac.uk>
+ *
+ * Version:
+ *	0.9-stage9
+ *
+ */
+
+#include "shell.h"
+
+#include <ctype.h>
+
+// Output goes to stdout, the shell's one buffered writer, which is flushed
+// before anything else is started (see launch_process())
+
+/* Get the value of a hexadecimal digit
+   
+   Params:
+   	c - The digit
+   
+   Returns:
+   	Its value, from 0 to 15.
+ */
+int hex_value(char c) {
+	return isdigit((unsigned char)c) ? c - '0' : tolower((unsigned char)c) - 'a' + 10;
+}
+
+/* Output a character in UTF-8
+   
+   Params:
+   	code - The character's code point
+ */
+void put_utf8(unsigned long code) {
+	if(code < 0x80)
+		putchar((int)code);
+	else if(code < 0x800) {
+		putchar(0xc0 | (int)(code >> 6));
+		putchar(0x80 | (int)(code & 0x3f));
+	}
+	else if(code < 0x10000) {
+		putchar(0xe0 | (int)(code >> 12));
+		putchar(0x80 | (int)((code >> 6) & 0x3f));
+		putchar(0x80 | (int)(code & 0x3f));
+	}
+	else {
+		putchar(0xf0 | (int)(code >> 18));
+		putchar(0x80 | (int)((code >> 12) & 0x3f));
+		putchar(0x80 | (int)((code >> 6) & 0x3f));
+		putchar(0x80 | (int)(code & 0x3f));
+	}
+	
+	return;
+}
+
+/* Output the escape sequence at the start of some text
+   
+   The sequences are those of printf: \\, \", \a, \b, \c (no further output),
+   \e, \f, \n, \r, \t, \v, \NNN (octal), \xHH, \uHHHH and \UHHHHHHHH. Anything
+   else is output as it is, backslash and all.
+   
+   Params:
+   	text - The text, starting with the backslash
+   	octal_0 - Whether octal sequences start with a 0 (\0NNN, as in echo -e
+   		and printf's %b) rather than being \NNN
+   	stop - Set to true if the sequence is \c
+   
+   Returns:
+   	The length of the sequence, or 0 if it's invalid (which has been
+   	reported).
+ */
+size_t put_escape(const char *text, bool octal_0, bool *stop) {
+	static const char *escapes = "\\\\\"\"a\ab\be\033f\fn\nr\rt\tv\v";
+	const char *position = text + 1;
+	
+	if(*position == 'c') {
+		*stop = true;
+		return 2;
+	}
+	
+	for(int i = 0; escapes[i] != '\0'; i += 2) {
+		if(*position == escapes[i]) {
+			putchar(escapes[i + 1]);
+			return 2;
+		}
+	}
+	
+	if(*position >= '0' && *position <= '7') {
+		int value = 0;
+		int digits = 0;
+		
+		if(octal_0 && *position == '0')
+			position++;
+		
+		for(; digits < 3 && *position >= '0' && *position <= '7'; digits++)
+			value = value * 8 + *position++ - '0';
+		
+		putchar(value & 0xff);
+		
+		return position - text;
+	}
+	
+	if(*position == 'x' || *position == 'u' || *position == 'U') {
+		int limit = (*position == 'x') ? 2 : (*position == 'u') ? 4 : 8;
+		unsigned long value = 0;
+		int digits = 0;
+		
+		for(position++; digits < limit && isxdigit((unsigned char)*position); digits++)
+			value = value * 16 + hex_value(*position++);
+		
+		if(digits == 0 || (limit > 2 && digits < limit)) {
+			fprintf(stderr, "printf: missing hexadecimal number in escape\n");
+			return 0;
+		}
+		
+		if(limit == 2)
+			putchar((int)value);
+		else
+			put_utf8(value);
+		
+		return position - text;
+	}
+	
+	// Not an escape sequence
+	putchar('\\');
+	
+	if(*position == '\0')
+		return 1;
+	
+	putchar(*position);
+	
+	return 2;
+}
+
+/* echo builtin
+   
+   As in coreutils, leading arguments made up of only n, e and E option
+   letters are options: -n leaves out the new line, -e turns on backslash
+   escapes (see put_escape()) and -E turns them off again.
+ */
+int builtin_echo(int argc, char *argv[]) {
+	bool newline = true;
+	bool escapes = false;
+	bool stop = false;
+	int first = 1;
+	
+	for(; first < argc && argv[first][0] == '-' && argv[first][1] != '\0'; first++) {
+		if(strspn(argv[first] + 1, "neE") != strlen(argv[first] + 1))
+			break;
+		
+		for(const char *option = argv[first] + 1; *option != '\0'; option++) {
+			if(*option == 'n')
+				newline = false;
+			else
+				escapes = (*option == 'e');
+		}
+	}
+	
+	for(int i = first; i < argc && !stop; i++) {
+		const char *text = argv[i];
+		
+		if(i > first)
+			putchar(' ');
+		
+		if(!escapes) {
+			fputs(text, stdout);
+			continue;
+		}
+		
+		while(*text != '\0' && !stop) {
+			// echo has no \", \u or \U
+			if(text[0] == '\\' && (text[1] == 'u' || text[1] == 'U' || text[1] == '"' ||
+				(text[1] == 'x' && !isxdigit((unsigned char)text[2])))) {
+				putchar(*text++);
+				putchar(*text++);
+			}
+			else if(*text == '\\')
+				text += put_escape(text, true, &stop);
+			else
+				putchar(*text++);
+		}
+	}
+	
+	if(newline && !stop)
+		putchar('\n');
+	
+	return 0;
+}
+
+/* true builtin */
+int builtin_true(int argc, char *argv[]) {
+	return 0;
+}
+
+/* false builtin */
+int builtin_false(int argc, char *argv[]) {
+	return 1;
+}
+
+/* Report an error in a test expression
+   
+   Params:
+   	test - The test state
+   	format - The message's printf() format
+   	argument - The string the format refers to
+ */
+void test_error(test_state_t *test, const char *format, const char *argument) {
+	if(!test->error) {
+		fprintf(stderr, "%s: ", test->name);
+		fprintf(stderr, format, argument);
+		fprintf(stderr, "\n");
+	}
+	
+	test->error = true;
+	
+	return;
+}
+
+/* Check that a test argument is an integer. As in coreutils, it may have 
+   any number of digits, so integers are compared as strings of digits rather
+   than converted.
+   
+   Params:
+   	test - The test state
+   	text - The argument, which may have blanks around it and a sign
+   	negative - Set to whether the integer is below 0
+   	length - Set to the number of digits, leaving out leading zeros
+   
+   Returns:
+   	The first digit that isn't a leading zero, or NULL if the argument isn't
+   	an integer (which has been reported).
+ */
+const char *test_integer(test_state_t *test, const char *text, bool *negative, 
+	size_t *length) {
+	const char *c = text;
+	const char *digits;
+	
+	while(*c == ' ' || *c == '\t')
+		c++;
+	
+	*negative = (*c == '-');
+	
+	if(*c == '-' || *c == '+')
+		c++;
+	
+	if(!isdigit((unsigned char)*c)) {
+		test_error(test, "invalid integer '%s'", text);
+		return NULL;
+	}
+	
+	while(*c == '0')
+		c++;
+	
+	for(digits = c; isdigit((unsigned char)*c); c++)
+		;
+	
+	*length = c - digits;
+	
+	while(*c == ' ' || *c == '\t')
+		c++;
+	
+	if(*c != '\0') {
+		test_error(test, "invalid integer '%s'", text);
+		return NULL;
+	}
+	
+	// -0 is the same as 0
+	if(*length == 0)
+		*negative = false;
+	
+	return digits;
+}
+
+/* Compare two test arguments as integers
+   
+   Params:
+   	test - The test state
+   	left - The left argument
+   	right - The right argument
+   
+   Returns:
+   	Less than, equal to or greater than 0 as the left integer is less than, 
+   	equal to or greater than the right, 0 if either is invalid (which has 
+   	been reported).
+ */
+int test_compare(test_state_t *test, const char *left, const char *right) {
+	bool left_negative, right_negative;
+	size_t left_length, right_length;
+	const char *left_digits = test_integer(test, left, &left_negative, &left_length);
+	const char *right_digits = test_integer(test, right, &right_negative, &right_length);
+	int order;
+	
+	if(left_digits == NULL || right_digits == NULL)
+		return 0;
+	
+	if(left_negative != right_negative)
+		return left_negative ? -1 : 1;
+	
+	if(left_length != right_length)
+		order = (left_length < right_length) ? -1 : 1;
+	else
+		order = memcmp(left_digits, right_digits, left_length);
+	
+	return left_negative ? -order : order;
+}
+
+/* Find a test's integer comparison operator
+   
+   Params:
+   	word - The word
+   
+   Returns:
+   	The operator's index in -eq, -ne, -lt, -le, -gt, -ge, or -1 if the word 
+   	isn't one.
+ */
+int test_integer_operator(const char *word) {
+	static const char *integer[] = { "-eq", "-ne", "-lt", "-le", "-gt", "-ge", NULL };
+	
+	for(int i = 0; integer[i] != NULL; i++) {
+		if(strcmp(word, integer[i]) == 0)
+			return i;
+	}
+	
+	return -1;
+}
+
+/* Check whether a word is a unary test operator
+   
+   Params:
+   	word - The word
+   
+   Returns:
+   	If it is, true is returned. Otherwise false.
+ */
+bool test_is_unary(const char *word) {
+	return word[0] == '-' && word[1] != '\0' && word[2] == '\0' &&
+		strchr("bcdefghkLnprsStuwxzGO", word[1]) != NULL;
+}
+
+/* Check whether a word is a binary test operator
+   
+   Params:
+   	word - The word
+   
+   Returns:
+   	If it is, true is returned. Otherwise false.
+ */
+bool test_is_binary(const char *word) {
+	static const char *binary[] = { "=", "==", "!=", "-eq", "-ne", "-lt", "-le", 
+		"-gt", "-ge", "-nt", "-ot", "-ef", NULL };
+	
+	for(int i = 0; binary[i] != NULL; i++) {
+		if(strcmp(word, binary[i]) == 0)
+			return true;
+	}
+	
+	return false;
+}
+
+/* Evaluate a unary test
+   
+   Params:
+   	test - The test state
+   	operator - The operator (e.g. -f)
+   	operand - Its operand
+   
+   Returns:
+   	The result.
+ */
+bool test_unary(test_state_t *test, const char *operator, const char *operand) {
+	struct stat info;
+	bool exists;
+	bool negative;
+	size_t length;
+	const char *digits;
+	
+	switch(operator[1]) {
+	case 'n':
+		return operand[0] != '\0';
+	case 'z':
+		return operand[0] == '\0';
+	case 't':
+		// A descriptor too large for an int can't be a terminal
+		if((digits = test_integer(test, operand, &negative, &length)) == NULL || 
+			negative || length > 9)
+			return false;
+		
+		return isatty(atoi(digits));
+	case 'r':
+		return access(operand, R_OK) == 0;
+	case 'w':
+		return access(operand, W_OK) == 0;
+	case 'x':
+		return access(operand, X_OK) == 0;
+	case 'h':
+	case 'L':
+		return lstat(operand, &info) == 0 && S_ISLNK(info.st_mode);
+	}
+	
+	exists = (stat(operand, &info) == 0);
+	
+	switch(operator[1]) {
+	case 'e':
+		return exists;
+	case 'f':
+		return exists && S_ISREG(info.st_mode);
+	case 'd':
+		return exists && S_ISDIR(info.st_mode);
+	case 'b':
+		return exists && S_ISBLK(info.st_mode);
+	case 'c':
+		return exists && S_ISCHR(info.st_mode);
+	case 'p':
+		return exists && S_ISFIFO(info.st_mode);
+	case 'S':
+		return exists && S_ISSOCK(info.st_mode);
+	case 's':
+		return exists && info.st_size > 0;
+	case 'g':
+		return exists && (info.st_mode & S_ISGID);
+	case 'u':
+		return exists && (info.st_mode & S_ISUID);
+	case 'k':
+		return exists && (info.st_mode & S_ISVTX);
+	case 'O':
+		return exists && info.st_uid == geteuid();
+	case 'G':
+		return exists && info.st_gid == getegid();
+	}
+	
+	return false;
+}
+
+/* Evaluate a binary test
+   
+   Params:
+   	test - The test state
+   	left - The left operand
+   	operator - The operator (e.g. -eq)
+   	right - The right operand
+   
+   Returns:
+   	The result.
+ */
+bool test_binary(test_state_t *test, const char *left, const char *operator,
+	const char *right) {
+	struct stat left_info, right_info;
+	bool left_exists, right_exists;
+	
+	if(strcmp(operator, "=") == 0 || strcmp(operator, "==") == 0)
+		return strcmp(left, right) == 0;
+	
+	if(strcmp(operator, "!=") == 0)
+		return strcmp(left, right) != 0;
+	
+	switch(test_integer_operator(operator)) {
+	case 0:
+		return test_compare(test, left, right) == 0;
+	case 1:
+		return test_compare(test, left, right) != 0;
+	case 2:
+		return test_compare(test, left, right) < 0;
+	case 3:
+		return test_compare(test, left, right) <= 0;
+	case 4:
+		return test_compare(test, left, right) > 0;
+	case 5:
+		return test_compare(test, left, right) >= 0;
+	}
+	
+	// File comparisons, a file that doesn't exist is older than any that does
+	left_exists = (stat(left, &left_info) == 0);
+	right_exists = (stat(right, &right_info) == 0);
+	
+	if(strcmp(operator, "-ef") == 0)
+		return left_exists && right_exists && left_info.st_dev == right_info.st_dev &&
+			left_info.st_ino == right_info.st_ino;
+	
+	if(!left_exists || !right_exists)
+		return (strcmp(operator, "-nt") == 0) ? left_exists : right_exists;
+	
+	if(left_info.st_mtim.tv_sec != right_info.st_mtim.tv_sec)
+		return (strcmp(operator, "-nt") == 0) ?
+			left_info.st_mtim.tv_sec > right_info.st_mtim.tv_sec :
+			left_info.st_mtim.tv_sec < right_info.st_mtim.tv_sec;
+	
+	return (strcmp(operator, "-nt") == 0) ?
+		left_info.st_mtim.tv_nsec > right_info.st_mtim.tv_nsec :
+		left_info.st_mtim.tv_nsec < right_info.st_mtim.tv_nsec;
+}
+
+/* Evaluate a binary test whose operands may be given as -l <string>, which
+   is the length of the string (as in coreutils, this is only meaningful to
+   the integer comparisons)
+   
+   Params:
+   	test - The test state, its position is moved past the test
+   	left_length - Whether the left operand is given as -l <string>
+   
+   Returns:
+   	The result.
+ */
+bool test_binary_length(test_state_t *test, bool left_length) {
+	char **argv = test->argv;
+	int operator = test->position + 1 + left_length;
+	bool right_length = (operator + 2 < test->argc && strcmp(argv[operator + 1], "-l") == 0);
+	const char *left = argv[operator - 1];
+	const char *right = argv[operator + 1 + right_length];
+	char left_number[24], right_number[24];
+	
+	test->position = operator + 2 + right_length;
+	
+	if((left_length || right_length) && argv[operator][0] == '-' &&
+		test_integer_operator(argv[operator]) < 0) {
+		test_error(test, "%s does not accept -l", argv[operator]);
+		return false;
+	}
+	
+	if(left_length && argv[operator][0] == '-') {
+		sprintf(left_number, "%zu", strlen(left));
+		left = left_number;
+	}
+	
+	if(right_length && argv[operator][0] == '-') {
+		sprintf(right_number, "%zu", strlen(right));
+		right = right_number;
+	}
+	
+	return test_binary(test, left, argv[operator], right);
+}
+
+/* Evaluate a primary test expression: ( expression ), a unary or binary
+   test, or a string (true if it isn't empty)
+   
+   Params:
+   	test - The test state, its position is moved past the expression
+   
+   Returns:
+   	The result.
+ */
+bool test_primary(test_state_t *test) {
+	char **argv = test->argv;
+	int position = test->position;
+	int remaining = test->argc - position;
+	bool result;
+	
+	if(remaining <= 0) {
+		test_error(test, "%s", "argument expected");
+		return false;
+	}
+	
+	if(remaining >= 4 && strcmp(argv[position], "-l") == 0 && 
+		test_is_binary(argv[position + 2]))
+		return test_binary_length(test, true);
+	
+	if(remaining >= 3 && test_is_binary(argv[position + 1]))
+		return test_binary_length(test, false);
+	
+	if(strcmp(argv[position], "(") == 0) {
+		test->position++;
+		result = test_or(test);
+		
+		if(test->position >= test->argc || strcmp(argv[test->position], ")") != 0)
+			test_error(test, "%s", "')' expected");
+		else
+			test->position++;
+		
+		return result;
+	}
+	
+	if(remaining >= 2 && test_is_unary(argv[position])) {
+		test->position += 2;
+		return test_unary(test, argv[position], argv[position + 1]);
+	}
+	
+	// As in coreutils, any other -X here is taken as a unary operator
+	if(argv[position][0] == '-' && argv[position][1] != '\0' && argv[position][2] == '\0') {
+		if(test_is_unary(argv[position]))
+			test_error(test, "missing argument after '%s'", argv[position]);
+		else
+			test_error(test, "'%s': unary operator expected", argv[position]);
+		
+		return false;
+	}
+	
+	test->position++;
+	
+	return argv[position][0] != '\0';
+}
+
+/* Evaluate a negated test expression, ! expression, or a primary one
+   
+   Params:
+   	test - The test state
+   
+   Returns:
+   	The result.
+ */
+bool test_not(test_state_t *test) {
+	if(test->position < test->argc && strcmp(test->argv[test->position], "!") == 0 &&
+		test->position + 1 < test->argc) {
+		test->position++;
+		return !test_not(test);
+	}
+	
+	return test_primary(test);
+}
+
+/* Evaluate expressions joined by -a
+   
+   Params:
+   	test - The test state
+   
+   Returns:
+   	The result.
+ */
+bool test_and(test_state_t *test) {
+	bool result = test_not(test);
+	
+	while(test->position < test->argc && strcmp(test->argv[test->position], "-a") == 0) {
+		test->position++;
+		result = test_not(test) && result;
+	}
+	
+	return result;
+}
+
+/* Evaluate expressions joined by -o
+   
+   Params:
+   	test - The test state
+   
+   Returns:
+   	The result.
+ */
+bool test_or(test_state_t *test) {
+	bool result = test_and(test);
+	
+	while(test->position < test->argc && strcmp(test->argv[test->position], "-o") == 0) {
+		test->position++;
+		result = test_and(test) || result;
+	}
+	
+	return result;
+}
+
+/* Evaluate a test expression of up to 4 arguments, as POSIX specifies
+   
+   Params:
+   	test - The test state, whose arguments are the expression
+   
+   Returns:
+   	The result.
+ */
+bool test_posix(test_state_t *test) {
+	char **argv = test->argv + test->position;
+	int count = test->argc - test->position;
+	
+	switch(count) {
+	case 0:
+		return false;
+	case 1:
+		test->position++;
+		return argv[0][0] != '\0';
+	case 2:
+		if(strcmp(argv[0], "!") == 0) {
+			test->position += 2;
+			return argv[1][0] == '\0';
+		}
+		
+		if(argv[0][0] == '-' && argv[0][1] != '\0' && argv[0][2] == '\0' && 
+			!test_is_unary(argv[0])) {
+			test_error(test, "'%s': unary operator expected", argv[0]);
+			return false;
+		}
+		
+		if(!test_is_unary(argv[0])) {
+			test_error(test, "missing argument after '%s'", argv[1]);
+			return false;
+		}
+		
+		break;
+	case 3:
+		if(test_is_binary(argv[1]))
+			break;
+		
+		if(strcmp(argv[0], "!") == 0) {
+			test->position++;
+			return !test_posix(test);
+		}
+		
+		if(strcmp(argv[0], "(") == 0 && strcmp(argv[2], ")") == 0) {
+			test->position += 3;
+			return argv[1][0] != '\0';
+		}
+		
+		if(strcmp(argv[1], "-a") != 0 && strcmp(argv[1], "-o") != 0) {
+			test_error(test, "'%s': binary operator expected", argv[1]);
+			return false;
+		}
+		
+		break;
+	case 4:
+		if(strcmp(argv[0], "!") == 0) {
+			test->position++;
+			return !test_posix(test);
+		}
+		
+		if(strcmp(argv[0], "(") == 0 && strcmp(argv[3], ")") == 0) {
+			bool result;
+			
+			test->argc--;
+			test->position++;
+			result = test_posix(test);
+			test->argc++;
+			test->position++;
+			
+			return result;
+		}
+		
+		break;
+	}
+	
+	return test_or(test);
+}
+
+/* test builtin, also run as [ (which needs a closing ]) */
+int builtin_test(int argc, char *argv[]) {
+	test_state_t test = { argv, argc, 1, argv[0], false };
+	bool result;
+	
+	if(strcmp(argv[0], "[") == 0) {
+		if(strcmp(argv[argc - 1], "]") != 0) {
+			fprintf(stderr, "[: missing ']'\n");
+			return 2;
+		}
+		
+		test.argc--;
+	}
+	
+	result = test_posix(&test);
+	
+	if(!test.error && test.position < test.argc)
+		test_error(&test, "extra argument '%s'", argv[test.position]);
+	
+	return test.error ? 2 : !result;
+}
+
+/* Get the next printf argument as a number
+   
+   Numbers may be decimal, octal (0NNN) or hexadecimal (0xHH), or a quote
+   followed by a character, which gives the character's code.
+   
+   Params:
+   	state - The printf state
+   	is_float - Whether a floating point number is needed
+   	is_signed - Whether a signed integer is needed
+   	value - Filled in with the number, as a uintmax_t, intmax_t or long double
+ */
+void printf_number(printf_state_t *state, bool is_float, bool is_signed, void *value) {
+	const char *text = (state->next < state->argc) ? state->argv[state->next++] : "0";
+	char *end;
+	
+	errno = 0;
+	
+	if(text[0] == '\'' || text[0] == '"') {
+		// A character constant
+		unsigned char c = (unsigned char)text[1];
+		
+		if(is_float)
+			*(long double *)value = c;
+		else if(is_signed)
+			*(intmax_t *)value = c;
+		else
+			*(uintmax_t *)value = c;
+		
+		return;
+	}
+	
+	if(is_float)
+		*(long double *)value = strtold(text, &end);
+	else if(is_signed)
+		*(intmax_t *)value = strtoimax(text, &end, 0);
+	else
+		*(uintmax_t *)value = strtoumax(text, &end, 0);
+	
+	if(end == text) {
+		fprintf(stderr, "printf: '%s': expected a numeric value\n", text);
+		state->status = 1;
+	}
+	else if(*end != '\0') {
+		fprintf(stderr, "printf: '%s': value not completely converted\n", text);
+		state->status = 1;
+	}
+	else if(errno == ERANGE) {
+		fprintf(stderr, "printf: '%s': %s\n", text, strerror(errno));
+		state->status = 1;
+	}
+	
+	return;
+}
+
+/* Output a printf format once, using arguments as its conversions need them
+   
+   Params:
+   	state - The printf state
+   	format - The format
+   	stop - Set to true if output should stop (because of \c)
+   
+   Returns:
+   	Whether the format is valid.
+ */
+bool printf_format(printf_state_t *state, const char *format, bool *stop) {
+	while(*format != '\0' && !*stop) {
+		char spec[64];
+		size_t spec_length = 1;
+		int values[2];
+		int value_count = 0;
+		char conversion;
+		
+		if(*format == '\\') {
+			size_t length = put_escape(format, false, stop);
+			
+			if(length == 0)
+				return false;
+			
+			format += length;
+			continue;
+		}
+		
+		if(*format != '%') {
+			putchar(*format++);
+			continue;
+		}
+		
+		if(format[1] == '%') {
+			putchar('%');
+			format += 2;
+			continue;
+		}
+		
+		// Copy the conversion's flags, width and precision, taking * from the
+		// arguments
+		spec[0] = '%';
+		format++;
+		
+		while(*format != '\0' && strchr("-+ #0'", *format) != NULL && spec_length < 16)
+			spec[spec_length++] = *format++;
+		
+		for(int part = 0; part < 2; part++) {
+			if(part == 1) {
+				if(*format != '.')
+					break;
+				
+				spec[spec_length++] = *format++;
+			}
+			
+			if(*format == '*') {
+				intmax_t value;
+				
+				printf_number(state, false, true, &value);
+				values[value_count++] = (int)value;
+				spec[spec_length++] = *format++;
+			}
+			else {
+				while(isdigit((unsigned char)*format) && spec_length < 48)
+					spec[spec_length++] = *format++;
+			}
+		}
+		
+		// Length modifiers are accepted and ignored, as the argument's size 
+		// comes from the conversion
+		while(*format != '\0' && strchr("hlLqjzt", *format) != NULL)
+			format++;
+		
+		conversion = *format;
+		
+		if(conversion == '\0' || strchr("diouxXcsbfFeEgGaA", conversion) == NULL) {
+			fprintf(stderr, "printf: %%%.*s: invalid conversion specification\n",
+				(int)(conversion == '\0' ? 0 : 1), format);
+			return false;
+		}
+		
+		format++;
+		
+		if(conversion == 'b') {
+			// A string with escapes, which may include \c
+			const char *text = (state->next < state->argc) ? state->argv[state->next++] : "";
+			
+			while(*text != '\0' && !*stop) {
+				if(*text == '\\') {
+					size_t length = put_escape(text, true, stop);
+					
+					if(length == 0)
+						return false;
+					
+					text += length;
+				}
+				else
+					putchar(*text++);
+			}
+			
+			continue;
+		}
+		
+		if(strchr("diouxX", conversion) != NULL) {
+			spec[spec_length++] = 'j';
+			spec[spec_length++] = conversion;
+			spec[spec_length] = '\0';
+			
+			if(conversion == 'd' || conversion == 'i') {
+				intmax_t value;
+				
+				printf_number(state, false, true, &value);
+				
+				if(value_count == 2)
+					printf(spec, values[0], values[1], value);
+				else if(value_count == 1)
+					printf(spec, values[0], value);
+				else
+					printf(spec, value);
+			}
+			else {
+				uintmax_t value;
+				
+				printf_number(state, false, false, &value);
+				
+				if(value_count == 2)
+					printf(spec, values[0], values[1], value);
+				else if(value_count == 1)
+					printf(spec, values[0], value);
+				else
+					printf(spec, value);
+			}
+		}
+		else if(strchr("fFeEgGaA", conversion) != NULL) {
+			long double value;
+			
+			printf_number(state, true, false, &value);
+			spec[spec_length++] = 'L';
+			spec[spec_length++] = conversion;
+			spec[spec_length] = '\0';
+			
+			if(value_count == 2)
+				printf(spec, values[0], values[1], value);
+			else if(value_count == 1)
+				printf(spec, values[0], value);
+			else
+				printf(spec, value);
+		}
+		else {
+			const char *text = (state->next < state->argc) ? state->argv[state->next++] : "";
+			
+			spec[spec_length++] = conversion;
+			spec[spec_length] = '\0';
+			
+			if(conversion == 'c') {
+				if(value_count == 2)
+					printf(spec, values[0], values[1], text[0]);
+				else if(value_count == 1)
+					printf(spec, values[0], text[0]);
+				else
+					printf(spec, text[0]);
+			}
+			else {
+				if(value_count == 2)
+					printf(spec, values[0], values[1], text);
+				else if(value_count == 1)
+					printf(spec, values[0], text);
+				else
+					printf(spec, text);
+			}
+		}
+	}
+	
+	return true;
+}
+
+/* printf builtin
+   
+   The format is used again for as long as arguments remain, as long as it
+   uses some each time. Missing arguments are taken as empty or 0, and a
+   warning is output if the format uses none of those given.
+ */
+int builtin_printf(int argc, char *argv[]) {
+	printf_state_t state = { argv, argc, 2, 0 };
+	bool stop = false;
+	int first = 1;
+	
+	if(argc > 1 && strcmp(argv[1], "--") == 0)
+		first++;
+	
+	if(first >= argc) {
+		fprintf(stderr, "printf: missing operand\n");
+		fprintf(stderr, "Try 'printf --help' for more information.\n");
+		return 1;
+	}
+	
+	state.next = first + 1;
+	
+	do {
+		int used = state.next;
+		
+		if(!printf_format(&state, argv[first], &stop))
+			return 1;
+		
+		if(state.next == used) {
+			if(used < argc && !stop) {
+				fflush(stdout);
+				fprintf(stderr, "printf: warning: ignoring excess arguments, starting with '%s'\n",
+					argv[used]);
+			}
+			
+			break;
+		}
+	} while(state.next < argc && !stop);
+	
+	return state.status;
+}
+
+/* command builtin, only reached without a command to run (run_tokens()
+   handles "command <command>" itself) */
+int builtin_command(int argc, char *argv[]) {
+	printf("usage: command <command> [args]...\n");
+	
+	return 2;
+}
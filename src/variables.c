@@ -0,0 +1,532 @@
+/*
+ * variables.c
+ *
+ * CS210 Semester 2 Shell Project
+ *
+ * Shell and exported variables, $ expansion and the environment given to the
+ * programs the shell starts.
+ *
+ * Authors:
+ *	Mark Anderson <mark.anderson@strath.ac.uk>
+ *	Andrew Logan <andrew.logan@strath.ac.uk>
+ *	John Meikle <john.meikle@strath.ac.uk>
+ *
+ * Version:
+ *	0.9-stage9
+ *
+ */
+
+#include "shell.h"
+
+// Stores the variables, chained by hash
+var_t *var_table[VAR_TABLE_SIZE];
+
+// Counts changes to the exported variables, so the environment is only built
+// again when one of them has changed
+unsigned long var_generation = 1;
+
+// Stores the environment given to programs, and the generation it was built
+// for. Its strings are the variables' own entries.
+char **var_envp = NULL;
+unsigned long var_envp_generation = 0;
+
+// Stores the shell's process ID, which $$ expands to even in a child shell
+pid_t var_shell_pid = 0;
+
+/* Hash a variable name (FNV-1a, as hash_string(), but of a length)
+   
+   Params:
+   	name - The name, which needn't be terminated
+   	length - The length of the name
+   
+   Returns:
+   	The hash value of the name.
+ */
+unsigned int var_hash(const char *name, size_t length) {
+	unsigned int hash = 2166136261u;
+	
+	for(size_t i = 0; i < length; i++) {
+		hash ^= (unsigned char)name[i];
+		hash *= 16777619u;
+	}
+	
+	return hash;
+}
+
+/* Check whether the start of some text is a variable name, i.e. a letter or
+   underscore followed by letters, digits and underscores
+   
+   Params:
+   	name - The text
+   
+   Returns:
+   	The length of the name, 0 if the text doesn't start with one.
+ */
+size_t var_name_length(const char *name) {
+	size_t length = 0;
+	
+	if(!isalpha((unsigned char)name[0]) && name[0] != '_')
+		return 0;
+	
+	while(isalnum((unsigned char)name[length]) || name[length] == '_')
+		length++;
+	
+	return length;
+}
+
+/* Check whether a word is a variable name
+   
+   Params:
+   	word - The word
+   
+   Returns:
+   	If the word is a valid name, true is returned. Otherwise false.
+ */
+bool var_valid_name(const char *word) {
+	size_t length = var_name_length(word);
+	
+	return length > 0 && word[length] == '\0';
+}
+
+/* Check whether a word is an assignment (NAME=value)
+   
+   Params:
+   	word - The word
+   
+   Returns:
+   	If the word is an assignment, true is returned. Otherwise false.
+ */
+bool is_assignment(const char *word) {
+	size_t length = var_name_length(word);
+	
+	return length > 0 && word[length] == '=';
+}
+
+/* Find a variable
+   
+   Params:
+   	name - The variable's name, which needn't be terminated
+   	length - The length of the name
+   
+   Returns:
+   	The variable, or NULL if it isn't set.
+ */
+var_t *var_find(const char *name, size_t length) {
+	var_t *var = var_table[var_hash(name, length) % VAR_TABLE_SIZE];
+	
+	while(var != NULL) {
+		if(var->name_length == length && memcmp(var->entry, name, length) == 0)
+			return var;
+		
+		var = var->next;
+	}
+	
+	return NULL;
+}
+
+/* Get the value of a variable
+   
+   Params:
+   	name - The variable's name
+   
+   Returns:
+   	The value, which is only valid until the variable is next changed, or
+   	NULL if it isn't set.
+ */
+const char *var_get(const char *name) {
+	size_t length = strlen(name);
+	var_t *var = var_find(name, length);
+	
+	return (var == NULL) ? NULL : var->entry + length + 1;
+}
+
+/* Keep the shell's own uses of a variable up to date with it
+   
+   Params:
+   	name - The name of the variable that has changed
+   	value - Its new value, or NULL if it has been unset
+ */
+void var_changed(const char *name, const char *value) {
+	if(strcmp(name, "PATH") == 0) {
+		env_path_current = (char *)value;
+		
+		// Previously resolved locations may no longer be correct
+		path_cache_clear();
+	}
+	else if(strcmp(name, "HOME") == 0)
+		// cd and the shell's own files (see home_file()) follow it
+		env_home = (char *)value;
+	
+	return;
+}
+
+/* Set a variable
+   
+   Params:
+   	name - The variable's name
+   	value - The value
+   	export - Whether to export it, a variable that's already exported stays so
+ */
+void var_set(const char *name, const char *value, bool export) {
+	size_t name_length = strlen(name);
+	size_t value_length = strlen(value);
+	var_t *var = var_find(name, name_length);
+	
+	// Stored as NAME=value, ready to go in the environment (the value may be
+	// the variable's old one, so that's only freed afterwards)
+	char *entry = malloc(name_length + value_length + 2);
+	
+	memcpy(entry, name, name_length);
+	entry[name_length] = '=';
+	memcpy(entry + name_length + 1, value, value_length + 1);
+	
+	if(var == NULL) {
+		unsigned int bucket = var_hash(name, name_length) % VAR_TABLE_SIZE;
+		
+		var = malloc(sizeof(var_t));
+		var->name_length = name_length;
+		var->exported = false;
+		var->next = var_table[bucket];
+		var_table[bucket] = var;
+	}
+	else
+		free(var->entry);
+	
+	var->entry = entry;
+	
+	if(export)
+		var->exported = true;
+	
+	if(var->exported)
+		var_generation++;
+	
+	var_changed(name, var->entry + name_length + 1);
+	
+	return;
+}
+
+/* Export a variable, setting it to an empty value if it isn't set
+   
+   Params:
+   	name - The variable's name
+ */
+void var_export(const char *name) {
+	var_t *var = var_find(name, strlen(name));
+	
+	if(var == NULL)
+		var_set(name, "", true);
+	else if(!var->exported) {
+		var->exported = true;
+		var_generation++;
+	}
+	
+	return;
+}
+
+/* Unset a variable
+   
+   Params:
+   	name - The variable's name
+ */
+void var_unset(const char *name) {
+	size_t length = strlen(name);
+	var_t **link = &var_table[var_hash(name, length) % VAR_TABLE_SIZE];
+	
+	while(*link != NULL) {
+		var_t *var = *link;
+		
+		if(var->name_length == length && memcmp(var->entry, name, length) == 0) {
+			*link = var->next;
+			
+			if(var->exported)
+				var_generation++;
+			
+			free(var->entry);
+			free(var);
+			var_changed(name, NULL);
+			return;
+		}
+		
+		link = &var->next;
+	}
+	
+	return;
+}
+
+/* Load the variables from the shell's environment, all exported */
+void var_init() {
+	var_shell_pid = getpid();
+	
+	for(char **entry = environ; *entry != NULL; entry++) {
+		char *equals = strchr(*entry, '=');
+		
+		if(equals == NULL)
+			continue;
+		
+		*equals = '\0';
+		var_set(*entry, equals + 1, true);
+		*equals = '=';
+	}
+	
+	return;
+}
+
+/* Get the environment for a program the shell starts
+   
+   It's only built again if an exported variable has changed since the last
+   time, so starting programs doesn't cost more for having exported variables.
+   
+   Returns:
+   	The environment, a NULL terminated array of NAME=value strings, which is
+   	only valid until an exported variable changes.
+ */
+char **var_environment() {
+	int count = 0;
+	
+	if(var_envp_generation == var_generation)
+		return var_envp;
+	
+	for(int i = 0; i < VAR_TABLE_SIZE; i++) {
+		for(var_t *var = var_table[i]; var != NULL; var = var->next)
+			count += var->exported;
+	}
+	
+	var_envp = realloc(var_envp, (count + 1) * sizeof(char *));
+	count = 0;
+	
+	for(int i = 0; i < VAR_TABLE_SIZE; i++) {
+		for(var_t *var = var_table[i]; var != NULL; var = var->next) {
+			if(var->exported)
+				var_envp[count++] = var->entry;
+		}
+	}
+	
+	var_envp[count] = NULL;
+	var_envp_generation = var_generation;
+	
+	return var_envp;
+}
+
+/* Expand the $NAME, ${NAME}, $? (the last exit status) and $$ (the shell's
+   process ID, see var_shell_pid) in a word. A variable that isn't set 
+   expands to nothing, and a $ that doesn't start any of those is left as it 
+   is, as are quoted ones (which the lexer has turned into QUOTED_DOLLAR). 
+   The value of a $ within double quotes (QUOTED_EXPANSION) is quoted, so it 
+   isn't taken as a pattern. Other quoted characters are left for 
+   expand_word() to put back.
+   
+   Params:
+   	word - The word
+   
+   Returns:
+   	A new string, which must be freed.
+ */
+char *var_expand(const char *word) {
+	buffer_t expanded = { NULL, 0, 0 };
+	
+	while(*word != '\0') {
+		const char *value = NULL;
+		const char *name = word + 1;
+		bool quoted = (*word == QUOTED_EXPANSION);
+		size_t length = 0;
+		char number[24];
+		char special;
+		
+		if(*word != '$' && !quoted) {
+			buffer_append(&expanded, (*word == QUOTED_DOLLAR) ? "$" : word, 1);
+			word++;
+			continue;
+		}
+		
+		// Within double quotes the lexer has quoted the ? or $ after a $ too,
+		// but a \$ is still literal
+		special = *name;
+		
+		if(quoted && *name == QUOTED_EXPANSION)
+			special = '$';
+		else if(quoted && *name == quote_character('?'))
+			special = '?';
+		
+		if(special == '?' || special == '$') {
+			sprintf(number, "%d", (special == '?') ? exit_status : (int)var_shell_pid);
+			value = number;
+			word += 2;
+		}
+		else if(*name == '{' && (length = var_name_length(name + 1)) > 0 &&
+			name[length + 1] == '}') {
+			var_t *var = var_find(name + 1, length);
+			
+			value = (var == NULL) ? "" : var->entry + length + 1;
+			word += length + 3;
+		}
+		else if((length = var_name_length(name)) > 0) {
+			var_t *var = var_find(name, length);
+			
+			value = (var == NULL) ? "" : var->entry + length + 1;
+			word += length + 1;
+		}
+		else {
+			buffer_append(&expanded, "$", 1);
+			word++;
+			continue;
+		}
+		
+		if(!quoted) {
+			buffer_append(&expanded, value, strlen(value));
+			continue;
+		}
+		
+		for(; *value != '\0'; value++) {
+			char c = quote_character(*value);
+			
+			buffer_append(&expanded, &c, 1);
+		}
+	}
+	
+	buffer_append(&expanded, "", 1);
+	
+	return expanded.data;
+}
+
+/* Compare two variables by name, for qsort()
+   
+   Params:
+   	a - A pointer to the first variable
+   	b - A pointer to the second variable
+   
+   Returns:
+   	Less than, equal to or greater than 0 as the first name sorts before,
+   	the same as or after the second.
+ */
+int var_compare(const void *a, const void *b) {
+	const var_t *var_a = *(var_t * const *)a;
+	const var_t *var_b = *(var_t * const *)b;
+	size_t length = (var_a->name_length < var_b->name_length) ?
+		var_a->name_length : var_b->name_length;
+	int order = memcmp(var_a->entry, var_b->entry, length);
+	
+	if(order != 0)
+		return order;
+	
+	return (var_a->name_length > var_b->name_length) -
+		(var_a->name_length < var_b->name_length);
+}
+
+/* List the exported variables in order of name, as export commands that would
+   set them again */
+void var_print_exports() {
+	int count = 0;
+	
+	for(int i = 0; i < VAR_TABLE_SIZE; i++) {
+		for(var_t *var = var_table[i]; var != NULL; var = var->next)
+			count += var->exported;
+	}
+	
+	var_t **sorted = malloc((count + 1) * sizeof(var_t *));
+	
+	count = 0;
+	
+	for(int i = 0; i < VAR_TABLE_SIZE; i++) {
+		for(var_t *var = var_table[i]; var != NULL; var = var->next) {
+			if(var->exported)
+				sorted[count++] = var;
+		}
+	}
+	
+	qsort(sorted, count, sizeof(var_t *), var_compare);
+	
+	for(int i = 0; i < count; i++) {
+		printf("export %.*s=\"", (int)sorted[i]->name_length, sorted[i]->entry);
+		
+		for(const char *c = sorted[i]->entry + sorted[i]->name_length + 1; *c != '\0'; c++) {
+			if(strchr("\"\\$`", *c) != NULL)
+				putchar('\\');
+			
+			putchar(*c);
+		}
+		
+		printf("\"\n");
+	}
+	
+	free(sorted);
+	
+	return;
+}
+
+/* export internal command
+   
+   Params:
+   	count - The number of arguments
+   	args - The arguments following "export", each NAME or NAME=value
+   
+   Returns:
+   	Whether every argument was a valid name.
+ */
+bool command_export(int count, char *args[]) {
+	bool valid = true;
+	
+	if(count == 0) {
+		var_print_exports();
+		return true;
+	}
+	
+	for(int i = 0; i < count; i++) {
+		if(is_assignment(args[i])) {
+			char *equals = strchr(args[i], '=');
+			
+			*equals = '\0';
+			var_set(args[i], equals + 1, true);
+			*equals = '=';
+		}
+		else if(var_valid_name(args[i]))
+			var_export(args[i]);
+		else {
+			fprintf(stderr, "export: '%s': not a valid identifier\n", args[i]);
+			valid = false;
+		}
+	}
+	
+	return valid;
+}
+
+/* unset internal command
+   
+   Params:
+   	count - The number of arguments
+   	args - The names of the variables to unset
+   
+   Returns:
+   	Whether every argument was a valid name.
+ */
+bool command_unset(int count, char *args[]) {
+	bool valid = true;
+	
+	for(int i = 0; i < count; i++) {
+		if(var_valid_name(args[i]))
+			var_unset(args[i]);
+		else {
+			fprintf(stderr, "unset: '%s': not a valid identifier\n", args[i]);
+			valid = false;
+		}
+	}
+	
+	return valid;
+}
+
+/* Set the variables of a command made only of assignments
+   
+   Params:
+   	count - The number of words
+   	words - The assignments, each NAME=value
+ */
+void command_assign(int count, char *words[]) {
+	for(int i = 0; i < count; i++) {
+		char *equals = strchr(words[i], '=');
+		
+		*equals = '\0';
+		var_set(words[i], equals + 1, false);
+		*equals = '=';
+	}
+	
+	return;
+}